@@ -0,0 +1,108 @@
+package modelfox
+
+// #include "helpers.h"
+import "C"
+
+import (
+	"sync"
+	"sync/atomic"
+	"unsafe"
+)
+
+// A classTable interns the class names of a model. Each class is assigned an index the first time it is seen, and that index never changes for the life of the model. Lookups are lock free, and only adding a class takes the lock.
+type classTable struct {
+	mutex sync.Mutex
+	list  atomic.Value
+	// These are the nul terminated copies of the class names and every class list ever published, which are freed when the model is destroyed because a concurrent prediction may still be reading an old list.
+	cNames    []*C.char
+	published []*classList
+}
+
+// A classList is an immutable snapshot of the classes in a classTable.
+type classList struct {
+	names   []string
+	indices map[string]int
+	// This is a C array of string views of the class names, in index order, that can be passed to helpers that look up class indices.
+	cNames *C.modelfox_string_view
+}
+
+func newClassTable() *classTable {
+	t := classTable{}
+	t.publish(&classList{indices: map[string]int{}})
+	return &t
+}
+
+func (t *classTable) load() *classList {
+	return t.list.Load().(*classList)
+}
+
+func (t *classTable) publish(list *classList) {
+	t.published = append(t.published, list)
+	t.list.Store(list)
+}
+
+// Retrieve the index and the interned name of the class `sv`, adding it to the table if it has not been seen before.
+func (t *classTable) intern(sv C.modelfox_string_view) (int, string) {
+	list := t.load()
+	if index, ok := list.indices[string(stringViewBytes(sv))]; ok {
+		return index, list.names[index]
+	}
+	t.mutex.Lock()
+	defer t.mutex.Unlock()
+	list = t.load()
+	if index, ok := list.indices[string(stringViewBytes(sv))]; ok {
+		return index, list.names[index]
+	}
+	name := C.GoStringN(sv.ptr, C.int(sv.len))
+	t.cNames = append(t.cNames, C.CString(name))
+	newList := classList{
+		names:   append(append([]string{}, list.names...), name),
+		indices: make(map[string]int, len(list.names)+1),
+	}
+	for index, name := range newList.names {
+		newList.indices[name] = index
+	}
+	var cName C.modelfox_string_view
+	newList.cNames = (*C.modelfox_string_view)(C.malloc(C.size_t(len(newList.names)) * C.size_t(unsafe.Sizeof(cName))))
+	cNames := (*[1 << 30]C.modelfox_string_view)(unsafe.Pointer(newList.cNames))[:len(newList.names):len(newList.names)]
+	for index, name := range newList.names {
+		cNames[index] = C.modelfox_string_view{
+			ptr: t.cNames[index],
+			len: C.size_t(len(name)),
+		}
+	}
+	t.publish(&newList)
+	return len(newList.names) - 1, name
+}
+
+func (t *classTable) destroy() {
+	t.mutex.Lock()
+	defer t.mutex.Unlock()
+	for _, list := range t.published {
+		C.free(unsafe.Pointer(list.cNames))
+	}
+	for _, cName := range t.cNames {
+		C.free(unsafe.Pointer(cName))
+	}
+	t.published = nil
+	t.cNames = nil
+}
+
+// Retrieve the bytes of a string view without copying them. The slice is only valid for as long as the string view is.
+func stringViewBytes(sv C.modelfox_string_view) []byte {
+	if sv.len == 0 {
+		return nil
+	}
+	return (*[1 << 30]byte)(unsafe.Pointer(sv.ptr))[:sv.len:sv.len]
+}
+
+// Create a string view of the bytes of `s` without copying them. Go strings are never modified and contain no pointers, so the view may be passed to a helper for the duration of a cgo call, as long as the helper does not keep it.
+func stringView(s string) C.modelfox_string_view {
+	if len(s) == 0 {
+		return C.modelfox_string_view{}
+	}
+	return C.modelfox_string_view{
+		ptr: (*C.char)(*(*unsafe.Pointer)(unsafe.Pointer(&s))),
+		len: C.size_t(len(s)),
+	}
+}
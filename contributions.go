@@ -0,0 +1,139 @@
+package modelfox
+
+// #include "helpers.h"
+import "C"
+
+import (
+	"log"
+	"strconv"
+	"unsafe"
+)
+
+// A FeatureContributionsView holds the feature contributions of a batch of predictions in libmodelfox's memory, and converts an entry to a Go value only when it is read. Reading a few entries of a model with many features is much cheaper than converting every entry up front as `Predict` does. The view must be closed with `view.Close` when it is no longer needed, and before the model is destroyed. A view must not be used by more than one goroutine at a time.
+//
+// Feature contributions are indexed by input and by class. Regression and binary classification models have a single class, with index 0. Multiclass classification models have one per class, in the order of `model.Classes()`.
+type FeatureContributionsView struct {
+	cInputVec  *C.modelfox_predict_input_vec
+	cOutputVec *C.modelfox_predict_output_vec
+	numInputs  int
+	numClasses int
+	// These point into `cOutputVec`. The feature contributions of input `i` and class `c` are at index `i * numClasses + c`, and are nil if the output has none.
+	cFeatureContributions []*C.modelfox_feature_contributions
+	// The names read from the view are interned in this batch, which is published to the model's name table when the view is closed.
+	names nameBatch
+}
+
+// Make predictions with multiple inputs and return a view of their feature contributions. Feature contributions are computed regardless of `options.ComputeFeatureContributions`. The batch is predicted with a single call to libmodelfox, so `options.NumThreads` is ignored, and so is `options.FeatureContributionsTopK`.
+func (m *Model) PredictFeatureContributionsView(input []PredictInput, options *PredictOptions) *FeatureContributionsView {
+	contributionOptions := PredictOptions{}
+	if options != nil {
+		contributionOptions = *options
+	}
+	contributionOptions.ComputeFeatureContributions = true
+	numClasses := 1
+	if m.task == MulticlassClassificationTaskType {
+		numClasses = len(m.Classes())
+	}
+	scratch := getPredictScratch()
+	cInputVec := newPredictInputVec(input, scratch)
+	scratch.release()
+	v := FeatureContributionsView{
+		cInputVec:             cInputVec,
+		cOutputVec:            m.predictOutputVec(cInputVec, &contributionOptions),
+		numInputs:             len(input),
+		numClasses:            numClasses,
+		cFeatureContributions: make([]*C.modelfox_feature_contributions, len(input)*numClasses),
+		names:                 m.names.batch(),
+	}
+	if len(v.cFeatureContributions) > 0 {
+		C.modelfox_go_predict_output_vec_get_feature_contributions(v.cOutputVec, m.task, C.size_t(len(input)), C.size_t(numClasses), &v.cFeatureContributions[0])
+	}
+	return &v
+}
+
+// Retrieve the number of inputs in the view.
+func (v *FeatureContributionsView) NumInputs() int {
+	return v.numInputs
+}
+
+// Retrieve the number of feature contributions for each input, which is one for regression and binary classification, and the number of classes for multiclass classification.
+func (v *FeatureContributionsView) NumClasses() int {
+	return v.numClasses
+}
+
+func (v *FeatureContributionsView) get(input int, class int) *C.modelfox_feature_contributions {
+	if v.cOutputVec == nil {
+		log.Fatal("modelfox error: the feature contributions view has been closed")
+	}
+	if class < 0 || class >= v.numClasses {
+		log.Fatal("modelfox error: the feature contributions view has no class with index " + strconv.Itoa(class))
+	}
+	return v.cFeatureContributions[input*v.numClasses+class]
+}
+
+// Retrieve the number of entries in the feature contributions of input `input` and class `class`.
+func (v *FeatureContributionsView) NumEntries(input int, class int) int {
+	cFeatureContributions := v.get(input, class)
+	if cFeatureContributions == nil {
+		return 0
+	}
+	var cLen C.size_t
+	C.modelfox_feature_contributions_get_entries_len(cFeatureContributions, &cLen)
+	return int(cLen)
+}
+
+// Retrieve the baseline value of the feature contributions of input `input` and class `class`.
+func (v *FeatureContributionsView) BaselineValue(input int, class int) float32 {
+	cFeatureContributions := v.get(input, class)
+	if cFeatureContributions == nil {
+		return 0
+	}
+	var baseline C.float
+	C.modelfox_feature_contributions_get_baseline_value(cFeatureContributions, &baseline)
+	return float32(baseline)
+}
+
+// Retrieve the output value of the feature contributions of input `input` and class `class`.
+func (v *FeatureContributionsView) OutputValue(input int, class int) float32 {
+	cFeatureContributions := v.get(input, class)
+	if cFeatureContributions == nil {
+		return 0
+	}
+	var output C.float
+	C.modelfox_feature_contributions_get_output_value(cFeatureContributions, &output)
+	return float32(output)
+}
+
+// Convert entry `index` of the feature contributions of input `input` and class `class` to a Go value.
+func (v *FeatureContributionsView) Entry(input int, class int, index int) FeatureContributionEntry {
+	cFeatureContributions := v.get(input, class)
+	if index < 0 || index >= v.NumEntries(input, class) {
+		log.Fatal("modelfox error: the feature contributions have no entry with index " + strconv.Itoa(index))
+	}
+	var cEntry C.modelfox_go_feature_contribution_entry
+	C.modelfox_go_feature_contributions_copy_entry(cFeatureContributions, C.size_t(index), &cEntry)
+	return makeFeatureContribution(&v.names, &cEntry)
+}
+
+// Copy the feature contribution values of the first `len(values)` entries of the feature contributions of input `input` and class `class` to `values`, with a single cgo call. Values past the last entry are set to zero.
+func (v *FeatureContributionsView) CopyValues(input int, class int, values []float32) {
+	cFeatureContributions := v.get(input, class)
+	if len(values) == 0 {
+		return
+	}
+	var baseline, output C.float
+	C.modelfox_go_feature_contributions_copy_values(cFeatureContributions, C.size_t(len(values)), &baseline, &output, (*C.float)(unsafe.Pointer(&values[0])))
+}
+
+// Free the predict outputs held by the view. The view must not be used afterward, and the entries already read from it remain valid.
+func (v *FeatureContributionsView) Close() {
+	if v.cOutputVec == nil {
+		return
+	}
+	v.names.publish()
+	C.modelfox_predict_output_vec_delete(v.cOutputVec)
+	C.modelfox_predict_input_vec_delete(v.cInputVec)
+	v.cOutputVec = nil
+	v.cInputVec = nil
+	v.cFeatureContributions = nil
+}
@@ -0,0 +1,244 @@
+package modelfox
+
+import (
+	"encoding/json"
+	"errors"
+	"math"
+	"strconv"
+	"time"
+	"unicode/utf8"
+)
+
+const (
+	predictionEventType = "prediction"
+	trueValueEventType  = "true_value"
+)
+
+// This is the threshold libmodelfox uses when `PredictOptions.Threshold` is not set.
+const defaultThreshold = 0.5
+
+// An event is a prediction or true value event to send to the app. Events are encoded to JSON by `appendEventsJSON` instead of by `encoding/json`, which avoids reflection and a map allocation for each event. The encoding decodes to the same values as the one `encoding/json` produces, but it is not byte for byte the same: map keys are written in iteration order instead of sorted, and `<`, `>`, `&`, U+2028, and U+2029 are written as is instead of escaped, which is valid JSON and does not change the decoded values.
+type event struct {
+	eventType  string
+	date       time.Time
+	identifier string
+	modelID    string
+	// These fields are set for prediction events.
+	input   PredictInput
+	options PredictOptions
+	output  PredictOutput
+	// This field is set for true value events.
+	trueValue interface{}
+}
+
+// Append the JSON encoding of `events`, an array of event objects, to `buf`.
+func appendEventsJSON(buf []byte, events []event) ([]byte, error) {
+	var err error
+	buf = append(buf, '[')
+	for i := range events {
+		if i > 0 {
+			buf = append(buf, ',')
+		}
+		buf, err = appendEventJSON(buf, &events[i])
+		if err != nil {
+			return nil, err
+		}
+	}
+	return append(buf, ']'), nil
+}
+
+func appendEventJSON(buf []byte, e *event) ([]byte, error) {
+	var err error
+	buf = append(buf, `{"date":"`...)
+	buf = e.date.AppendFormat(buf, time.RFC3339)
+	buf = append(buf, `","identifier":`...)
+	buf = appendJSONString(buf, e.identifier)
+	if e.eventType == predictionEventType {
+		buf = append(buf, `,"input":`...)
+		if buf, err = appendPredictInputJSON(buf, e.input); err != nil {
+			return nil, err
+		}
+	}
+	buf = append(buf, `,"modelId":`...)
+	buf = appendJSONString(buf, e.modelID)
+	if e.eventType == predictionEventType {
+		// A prediction made without setting the threshold used libmodelfox's default, so that is the threshold logged.
+		threshold := e.options.Threshold
+		if threshold == 0 {
+			threshold = defaultThreshold
+		}
+		buf = append(buf, `,"options":{"threshold":`...)
+		if buf, err = appendJSONFloat(buf, float64(threshold), 32); err != nil {
+			return nil, err
+		}
+		buf = append(buf, `,"computeFeatureContributions":`...)
+		buf = strconv.AppendBool(buf, e.options.ComputeFeatureContributions)
+		buf = append(buf, `},"output":`...)
+		if buf, err = appendPredictOutputJSON(buf, e.output); err != nil {
+			return nil, err
+		}
+	} else {
+		buf = append(buf, `,"trueValue":`...)
+		if buf, err = appendJSONValue(buf, e.trueValue); err != nil {
+			return nil, err
+		}
+	}
+	buf = append(buf, `,"type":`...)
+	buf = appendJSONString(buf, e.eventType)
+	return append(buf, '}'), nil
+}
+
+func appendPredictInputJSON(buf []byte, input PredictInput) ([]byte, error) {
+	if input == nil {
+		return append(buf, "null"...), nil
+	}
+	var err error
+	buf = append(buf, '{')
+	first := true
+	for key, value := range input {
+		if !first {
+			buf = append(buf, ',')
+		}
+		first = false
+		buf = appendJSONString(buf, key)
+		buf = append(buf, ':')
+		if buf, err = appendJSONValue(buf, value); err != nil {
+			return nil, err
+		}
+	}
+	return append(buf, '}'), nil
+}
+
+func appendPredictOutputJSON(buf []byte, output PredictOutput) ([]byte, error) {
+	var err error
+	switch output := output.(type) {
+	case RegressionPredictOutput:
+		buf = append(buf, `{"value":`...)
+		if buf, err = appendJSONFloat(buf, float64(output.Value), 32); err != nil {
+			return nil, err
+		}
+		return append(buf, '}'), nil
+	case BinaryClassificationPredictOutput:
+		buf = append(buf, `{"className":`...)
+		buf = appendJSONString(buf, output.ClassName)
+		buf = append(buf, `,"probability":`...)
+		if buf, err = appendJSONFloat(buf, float64(output.Probability), 32); err != nil {
+			return nil, err
+		}
+		return append(buf, '}'), nil
+	case MulticlassClassificationPredictOutput:
+		buf = append(buf, `{"className":`...)
+		buf = appendJSONString(buf, output.ClassName)
+		buf = append(buf, `,"probability":`...)
+		if buf, err = appendJSONFloat(buf, float64(output.Probability), 32); err != nil {
+			return nil, err
+		}
+		buf = append(buf, `,"probabilities":{`...)
+		first := true
+		for className, probability := range output.Probabilities {
+			if !first {
+				buf = append(buf, ',')
+			}
+			first = false
+			buf = appendJSONString(buf, className)
+			buf = append(buf, ':')
+			if buf, err = appendJSONFloat(buf, float64(probability), 32); err != nil {
+				return nil, err
+			}
+		}
+		return append(buf, "}}"...), nil
+	default:
+		return appendJSONValue(buf, output)
+	}
+}
+
+// Append the JSON encoding of a value in a `PredictInput` or a true value. Values of types other than the ones `Predict` accepts are encoded with `encoding/json`.
+func appendJSONValue(buf []byte, value interface{}) ([]byte, error) {
+	switch value := value.(type) {
+	case nil:
+		return append(buf, "null"...), nil
+	case string:
+		return appendJSONString(buf, value), nil
+	case float64:
+		return appendJSONFloat(buf, value, 64)
+	case float32:
+		return appendJSONFloat(buf, float64(value), 32)
+	case int:
+		return strconv.AppendInt(buf, int64(value), 10), nil
+	case bool:
+		return strconv.AppendBool(buf, value), nil
+	default:
+		data, err := json.Marshal(value)
+		if err != nil {
+			return nil, err
+		}
+		return append(buf, data...), nil
+	}
+}
+
+func appendJSONFloat(buf []byte, value float64, bitSize int) ([]byte, error) {
+	if math.IsNaN(value) || math.IsInf(value, 0) {
+		return nil, errors.New("modelfox error: cannot log the value " + strconv.FormatFloat(value, 'g', -1, bitSize))
+	}
+	// Format numbers the same way as `encoding/json`.
+	abs := math.Abs(value)
+	format := byte('f')
+	if abs != 0 {
+		if bitSize == 64 && (abs < 1e-6 || abs >= 1e21) || bitSize == 32 && (float32(abs) < 1e-6 || float32(abs) >= 1e21) {
+			format = 'e'
+		}
+	}
+	buf = strconv.AppendFloat(buf, value, format, -1, bitSize)
+	if format == 'e' {
+		// Clean up e-09 to e-9.
+		n := len(buf)
+		if n >= 4 && buf[n-4] == 'e' && buf[n-3] == '-' && buf[n-2] == '0' {
+			buf[n-2] = buf[n-1]
+			buf = buf[:n-1]
+		}
+	}
+	return buf, nil
+}
+
+const hexDigits = "0123456789abcdef"
+
+func appendJSONString(buf []byte, s string) []byte {
+	buf = append(buf, '"')
+	start := 0
+	for i := 0; i < len(s); {
+		c := s[i]
+		if c < utf8.RuneSelf {
+			if c >= 0x20 && c != '"' && c != '\\' {
+				i++
+				continue
+			}
+			buf = append(buf, s[start:i]...)
+			switch c {
+			case '"', '\\':
+				buf = append(buf, '\\', c)
+			case '\n':
+				buf = append(buf, '\\', 'n')
+			case '\r':
+				buf = append(buf, '\\', 'r')
+			case '\t':
+				buf = append(buf, '\\', 't')
+			default:
+				buf = append(buf, '\\', 'u', '0', '0', hexDigits[c>>4], hexDigits[c&0xf])
+			}
+			i++
+			start = i
+			continue
+		}
+		r, size := utf8.DecodeRuneInString(s[i:])
+		if r == utf8.RuneError && size == 1 {
+			buf = append(buf, s[start:i]...)
+			buf = append(buf, `\ufffd`...)
+			i += size
+			start = i
+			continue
+		}
+		i += size
+	}
+	buf = append(buf, s[start:]...)
+	return append(buf, '"')
+}
@@ -0,0 +1,143 @@
+package modelfox
+
+import (
+	"encoding/json"
+	"reflect"
+	"strconv"
+	"testing"
+	"time"
+)
+
+// Encode `e` with `encoding/json` the way events were encoded before `appendEventsJSON`, as a map holding the same fields.
+func referenceEventJSON(t testing.TB, e event) []byte {
+	t.Helper()
+	fields := map[string]interface{}{
+		"date":       e.date.Format(time.RFC3339),
+		"identifier": e.identifier,
+		"modelId":    e.modelID,
+		"type":       e.eventType,
+	}
+	if e.eventType == predictionEventType {
+		options := e.options
+		if options.Threshold == 0 {
+			options.Threshold = defaultThreshold
+		}
+		fields["input"] = e.input
+		fields["options"] = options
+		fields["output"] = e.output
+	} else {
+		fields["trueValue"] = e.trueValue
+	}
+	data, err := json.Marshal([]interface{}{fields})
+	if err != nil {
+		t.Fatal(err)
+	}
+	return data
+}
+
+func TestAppendEventsJSON(t *testing.T) {
+	date := time.Date(2021, 6, 1, 12, 30, 0, 0, time.FixedZone("", -7*60*60))
+	prediction := func(input PredictInput, options PredictOptions, output PredictOutput) event {
+		return event{eventType: predictionEventType, date: date, identifier: "id", modelID: "model", input: input, options: options, output: output}
+	}
+	trueValue := func(identifier string, value interface{}) event {
+		return event{eventType: trueValueEventType, date: date, identifier: identifier, modelID: "model", trueValue: value}
+	}
+	tests := []struct {
+		name  string
+		event event
+	}{
+		{"regression", prediction(PredictInput{"age": 63.0, "gender": "male"}, PredictOptions{}, RegressionPredictOutput{Value: 1.5})},
+		{"binary", prediction(PredictInput{"x": 1.0}, PredictOptions{Threshold: 0.3, ComputeFeatureContributions: true}, BinaryClassificationPredictOutput{ClassName: "Positive", Probability: 0.7})},
+		{"multiclass", prediction(PredictInput{"x": 1.0}, PredictOptions{}, MulticlassClassificationPredictOutput{ClassName: "b", Probability: 0.6, Probabilities: map[string]float32{"a": 0.1, "b": 0.6, "c": 0.3}})},
+		{"nil input", prediction(nil, PredictOptions{}, RegressionPredictOutput{Value: 0})},
+		{"empty input", prediction(PredictInput{}, PredictOptions{}, RegressionPredictOutput{Value: -2})},
+		{"input types", prediction(PredictInput{"f64": 0.1, "f32": float32(0.1), "int": -7, "bool": true, "nil": nil, "slice": []int{1, 2}, "string": "text"}, PredictOptions{}, RegressionPredictOutput{Value: 3})},
+		{"small and large numbers", prediction(PredictInput{"a": 1e-7, "b": 1e21, "c": 123456789.0, "d": -0.000001, "e": float32(1e-7), "f": float32(3e38)}, PredictOptions{}, RegressionPredictOutput{Value: 1e-9})},
+		{"escapes", trueValue("quote \" backslash \\ newline \n tab \t control \x01", "é中\U0001f600")},
+		{"html and line separators", trueValue("<script>&</script>", "\u2028\u2029")},
+		{"invalid utf8", trueValue("a\xffb", "\xc3")},
+		{"escaped keys", prediction(PredictInput{"<key>": "\"v\"", "k ": 1.0}, PredictOptions{}, RegressionPredictOutput{Value: 1})},
+		{"number true value", trueValue("id", 42.5)},
+		{"bool true value", trueValue("id", false)},
+		{"nil true value", trueValue("id", nil)},
+		{"map true value", trueValue("id", map[string]int{"b": 2, "a": 1})},
+	}
+	for _, test := range tests {
+		t.Run(test.name, func(t *testing.T) {
+			got, err := appendEventsJSON(nil, []event{test.event})
+			if err != nil {
+				t.Fatal(err)
+			}
+			want := referenceEventJSON(t, test.event)
+			var gotValue, wantValue interface{}
+			if err := json.Unmarshal(got, &gotValue); err != nil {
+				t.Fatalf("%s is not valid JSON: %v", got, err)
+			}
+			if err := json.Unmarshal(want, &wantValue); err != nil {
+				t.Fatal(err)
+			}
+			if !reflect.DeepEqual(gotValue, wantValue) {
+				t.Fatalf("got %s, expected the same value as %s", got, want)
+			}
+		})
+	}
+}
+
+func benchmarkEvents() []event {
+	events := make([]event, 100)
+	for i, input := range testInputs(len(events)) {
+		events[i] = event{
+			eventType:  predictionEventType,
+			date:       time.Now(),
+			identifier: strconv.Itoa(i),
+			modelID:    "model",
+			input:      input,
+			output:     BinaryClassificationPredictOutput{ClassName: "Positive", Probability: 0.75},
+		}
+	}
+	return events
+}
+
+// Run with `go test -bench EventsJSON -benchmem` to compare the event encoder with `encoding/json`.
+func BenchmarkEventsJSON(b *testing.B) {
+	events := benchmarkEvents()
+	b.Run("appendEventsJSON", func(b *testing.B) {
+		var buf []byte
+		var err error
+		b.ReportAllocs()
+		start := time.Now()
+		for i := 0; i < b.N; i++ {
+			if buf, err = appendEventsJSON(buf[:0], events); err != nil {
+				b.Fatal(err)
+			}
+		}
+		b.ReportMetric(float64(time.Since(start).Nanoseconds())/float64(b.N*len(events)), "ns/event")
+		b.ReportMetric(float64(len(buf))/float64(len(events)), "bytes/event")
+	})
+	b.Run("encoding/json", func(b *testing.B) {
+		var body []byte
+		var err error
+		b.ReportAllocs()
+		start := time.Now()
+		for i := 0; i < b.N; i++ {
+			maps := make([]map[string]interface{}, len(events))
+			for j, e := range events {
+				maps[j] = map[string]interface{}{
+					"date":       e.date.Format(time.RFC3339),
+					"identifier": e.identifier,
+					"input":      e.input,
+					"modelId":    e.modelID,
+					"options":    e.options,
+					"output":     e.output,
+					"type":       e.eventType,
+				}
+			}
+			if body, err = json.Marshal(maps); err != nil {
+				b.Fatal(err)
+			}
+		}
+		b.ReportMetric(float64(time.Since(start).Nanoseconds())/float64(b.N*len(events)), "ns/event")
+		b.ReportMetric(float64(len(body))/float64(len(events)), "bytes/event")
+	})
+}
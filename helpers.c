@@ -0,0 +1,551 @@
+#include <string.h>
+
+#include "helpers.h"
+
+// libmodelfox expects nul terminated strings, so values are copied into a scratch buffer large enough for the longest of the `len` strings delimited by `offsets`.
+static char *modelfox_go_scratch_new(const size_t *offsets, size_t len) {
+  size_t max_len = 0;
+  for (size_t i = 0; i < len; i++) {
+    size_t value_len = offsets[i + 1] - offsets[i];
+    if (value_len > max_len) {
+      max_len = value_len;
+    }
+  }
+  return malloc(max_len + 1);
+}
+
+static const char *modelfox_go_scratch_set(char *scratch, const char *data, const size_t *offsets, size_t index) {
+  size_t value_len = offsets[index + 1] - offsets[index];
+  memcpy(scratch, data + offsets[index], value_len);
+  scratch[value_len] = '\0';
+  return scratch;
+}
+
+// Copy a string view into a new nul terminated string, which the caller must free.
+static char *modelfox_go_string_new(modelfox_string_view sv) {
+  char *s = malloc(sv.len + 1);
+  if (sv.len > 0) {
+    memcpy(s, sv.ptr, sv.len);
+  }
+  s[sv.len] = '\0';
+  return s;
+}
+
+static intptr_t modelfox_go_class_index(const modelfox_string_view *class_names, size_t num_class_names, modelfox_string_view class_name) {
+  for (size_t i = 0; i < num_class_names; i++) {
+    if (class_names[i].len == class_name.len && memcmp(class_names[i].ptr, class_name.ptr, class_name.len) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+modelfox_error *modelfox_go_model_from_path(modelfox_string_view path,
+                                            const modelfox_model **model_ptr) {
+  char *c_path = modelfox_go_string_new(path);
+  modelfox_error *error = modelfox_model_from_path(c_path, model_ptr);
+  free(c_path);
+  return error;
+}
+
+void modelfox_go_predict_inputs_new(modelfox_predict_input **predict_inputs,
+                                    size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    modelfox_predict_input_new((const modelfox_predict_input **)&predict_inputs[i]);
+  }
+}
+
+modelfox_error *modelfox_go_predict_inputs_set_number_column(modelfox_predict_input **predict_inputs,
+                                                             size_t len,
+                                                             modelfox_string_view column_name,
+                                                             const double *values) {
+  char *c_column_name = modelfox_go_string_new(column_name);
+  modelfox_error *error = NULL;
+  for (size_t i = 0; i < len; i++) {
+    error = modelfox_predict_input_set_value_number(predict_inputs[i], c_column_name, values[i]);
+    if (error != NULL) {
+      break;
+    }
+  }
+  free(c_column_name);
+  return error;
+}
+
+modelfox_error *modelfox_go_predict_inputs_set_string_column(modelfox_predict_input **predict_inputs,
+                                                             size_t len,
+                                                             modelfox_string_view column_name,
+                                                             const char *data,
+                                                             const size_t *offsets) {
+  char *c_column_name = modelfox_go_string_new(column_name);
+  char *scratch = modelfox_go_scratch_new(offsets, len);
+  modelfox_error *error = NULL;
+  for (size_t i = 0; i < len; i++) {
+    const char *value = modelfox_go_scratch_set(scratch, data, offsets, i);
+    error = modelfox_predict_input_set_value_string(predict_inputs[i], c_column_name, value);
+    if (error != NULL) {
+      break;
+    }
+  }
+  free(scratch);
+  free(c_column_name);
+  return error;
+}
+
+void modelfox_go_predict_input_vec_push_all(modelfox_predict_input_vec *predict_input_vec,
+                                            modelfox_predict_input **predict_inputs,
+                                            size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    modelfox_predict_input_vec_push(predict_input_vec, predict_inputs[i]);
+  }
+}
+
+modelfox_error *modelfox_go_predict_input_vec_push_rows(modelfox_predict_input_vec *predict_input_vec,
+                                                        const char *const *column_names,
+                                                        size_t num_columns,
+                                                        size_t len,
+                                                        const uint8_t *kinds,
+                                                        const double *numbers,
+                                                        const char *string_data,
+                                                        const size_t *string_offsets) {
+  char *scratch = modelfox_go_scratch_new(string_offsets, len * num_columns);
+  modelfox_error *error = NULL;
+  for (size_t i = 0; i < len && error == NULL; i++) {
+    modelfox_predict_input *predict_input;
+    modelfox_predict_input_new((const modelfox_predict_input **)&predict_input);
+    modelfox_predict_input_vec_push(predict_input_vec, predict_input);
+    for (size_t j = 0; j < num_columns && error == NULL; j++) {
+      size_t k = i * num_columns + j;
+      switch (kinds[k]) {
+      case MODELFOX_GO_VALUE_NUMBER:
+        error = modelfox_predict_input_set_value_number(predict_input, column_names[j], numbers[k]);
+        break;
+      case MODELFOX_GO_VALUE_STRING:
+        error = modelfox_predict_input_set_value_string(predict_input, column_names[j], modelfox_go_scratch_set(scratch, string_data, string_offsets, k));
+        break;
+      }
+    }
+  }
+  free(scratch);
+  return error;
+}
+
+modelfox_error *modelfox_go_predict_input_vec_push_maps(modelfox_predict_input_vec *predict_input_vec,
+                                                        size_t len,
+                                                        const size_t *row_lens,
+                                                        const uint8_t *kinds,
+                                                        const double *numbers,
+                                                        const char *data,
+                                                        const size_t *offsets) {
+  size_t num_values = 0;
+  for (size_t i = 0; i < len; i++) {
+    num_values += row_lens[i];
+  }
+  // Keys and values are both nul terminated at the same time, so each needs its own scratch buffer.
+  char *key_scratch = modelfox_go_scratch_new(offsets, 2 * num_values);
+  char *value_scratch = modelfox_go_scratch_new(offsets, 2 * num_values);
+  modelfox_error *error = NULL;
+  size_t k = 0;
+  for (size_t i = 0; i < len && error == NULL; i++) {
+    modelfox_predict_input *predict_input;
+    modelfox_predict_input_new((const modelfox_predict_input **)&predict_input);
+    modelfox_predict_input_vec_push(predict_input_vec, predict_input);
+    for (size_t j = 0; j < row_lens[i] && error == NULL; j++, k++) {
+      switch (kinds[k]) {
+      case MODELFOX_GO_VALUE_NUMBER:
+        error = modelfox_predict_input_set_value_number(predict_input, modelfox_go_scratch_set(key_scratch, data, offsets, 2 * k), numbers[k]);
+        break;
+      case MODELFOX_GO_VALUE_STRING:
+        error = modelfox_predict_input_set_value_string(predict_input, modelfox_go_scratch_set(key_scratch, data, offsets, 2 * k), modelfox_go_scratch_set(value_scratch, data, offsets, 2 * k + 1));
+        break;
+      }
+    }
+  }
+  free(key_scratch);
+  free(value_scratch);
+  return error;
+}
+
+static void modelfox_go_feature_contribution_entry_copy(const modelfox_feature_contribution_entry *entry,
+                                                       modelfox_go_feature_contribution_entry *out) {
+  memset(out, 0, sizeof *out);
+  modelfox_feature_contribution_entry_get_type(entry, &out->type);
+  switch (out->type) {
+  case IDENTITY: {
+    const modelfox_identity_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_identity(entry, &feature_contribution);
+    modelfox_identity_feature_contribution_get_column_name(feature_contribution, &out->column_name);
+    modelfox_identity_feature_contribution_get_feature_value(feature_contribution, &out->feature_value);
+    modelfox_identity_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    break;
+  }
+  case NORMALIZED: {
+    const modelfox_normalized_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_normalized(entry, &feature_contribution);
+    modelfox_normalized_feature_contribution_get_column_name(feature_contribution, &out->column_name);
+    modelfox_normalized_feature_contribution_get_feature_value(feature_contribution, &out->feature_value);
+    modelfox_normalized_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    break;
+  }
+  case ONE_HOT_ENCODED: {
+    const modelfox_one_hot_encoded_feature_contribution *feature_contribution;
+    bool feature_value;
+    modelfox_feature_contribution_entry_as_one_hot_encoded(entry, &feature_contribution);
+    modelfox_one_hot_encoded_feature_contribution_get_column_name(feature_contribution, &out->column_name);
+    modelfox_one_hot_encoded_feature_contribution_get_variant(feature_contribution, &out->variant);
+    modelfox_one_hot_encoded_feature_contribution_get_feature_value(feature_contribution, &feature_value);
+    modelfox_one_hot_encoded_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    out->feature_value = feature_value ? 1 : 0;
+    break;
+  }
+  case BAG_OF_WORDS: {
+    const modelfox_bag_of_words_feature_contribution *feature_contribution;
+    const modelfox_ngram *ngram;
+    modelfox_feature_contribution_entry_as_bag_of_words(entry, &feature_contribution);
+    modelfox_bag_of_words_feature_contribution_get_column_name(feature_contribution, &out->column_name);
+    modelfox_bag_of_words_feature_contribution_get_feature_value(feature_contribution, &out->feature_value);
+    modelfox_bag_of_words_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    modelfox_bag_of_words_feature_contribution_get_ngram(feature_contribution, &ngram);
+    modelfox_ngram_get_type(ngram, &out->ngram_type);
+    switch (out->ngram_type) {
+    case UNIGRAM:
+      modelfox_unigram_get_token(ngram, &out->token_a);
+      break;
+    case BIGRAM:
+      modelfox_bigram_get_token_a(ngram, &out->token_a);
+      modelfox_bigram_get_token_b(ngram, &out->token_b);
+      break;
+    }
+    break;
+  }
+  case BAG_OF_WORDS_COSINE_SIMILARITY: {
+    const modelfox_bag_of_words_cosine_similarity_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_bag_of_words_cosine_similarity(entry, &feature_contribution);
+    modelfox_bag_of_words_cosine_similarity_feature_contribution_get_column_name_a(feature_contribution, &out->column_name);
+    modelfox_bag_of_words_cosine_similarity_feature_contribution_get_column_name_b(feature_contribution, &out->column_name_b);
+    modelfox_bag_of_words_cosine_similarity_feature_contribution_get_feature_value(feature_contribution, &out->feature_value);
+    modelfox_bag_of_words_cosine_similarity_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    break;
+  }
+  case WORD_EMBEDDING: {
+    const modelfox_word_embedding_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_word_embedding(entry, &feature_contribution);
+    modelfox_word_embedding_feature_contribution_get_column_name(feature_contribution, &out->column_name);
+    modelfox_word_embedding_feature_contribution_get_value_index(feature_contribution, &out->value_index);
+    modelfox_word_embedding_feature_contribution_get_feature_contribution_value(feature_contribution, &out->feature_contribution_value);
+    break;
+  }
+  }
+}
+
+void modelfox_go_feature_contributions_copy_entries(const modelfox_feature_contributions *feature_contributions,
+                                                    size_t len,
+                                                    modelfox_go_feature_contribution_entry *entries) {
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_feature_contribution_entry *entry;
+    modelfox_feature_contributions_get_entry_at_index(feature_contributions, i, &entry);
+    modelfox_go_feature_contribution_entry_copy(entry, &entries[i]);
+  }
+}
+
+void modelfox_go_feature_contributions_copy_entry(const modelfox_feature_contributions *feature_contributions,
+                                                  size_t index,
+                                                  modelfox_go_feature_contribution_entry *entry) {
+  const modelfox_feature_contribution_entry *feature_contribution_entry;
+  modelfox_feature_contributions_get_entry_at_index(feature_contributions, index, &feature_contribution_entry);
+  modelfox_go_feature_contribution_entry_copy(feature_contribution_entry, entry);
+}
+
+static float modelfox_go_feature_contribution_entry_value(const modelfox_feature_contribution_entry *entry) {
+  modelfox_feature_contribution_entry_type type;
+  float value = 0;
+  modelfox_feature_contribution_entry_get_type(entry, &type);
+  switch (type) {
+  case IDENTITY: {
+    const modelfox_identity_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_identity(entry, &feature_contribution);
+    modelfox_identity_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  case NORMALIZED: {
+    const modelfox_normalized_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_normalized(entry, &feature_contribution);
+    modelfox_normalized_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  case ONE_HOT_ENCODED: {
+    const modelfox_one_hot_encoded_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_one_hot_encoded(entry, &feature_contribution);
+    modelfox_one_hot_encoded_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  case BAG_OF_WORDS: {
+    const modelfox_bag_of_words_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_bag_of_words(entry, &feature_contribution);
+    modelfox_bag_of_words_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  case BAG_OF_WORDS_COSINE_SIMILARITY: {
+    const modelfox_bag_of_words_cosine_similarity_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_bag_of_words_cosine_similarity(entry, &feature_contribution);
+    modelfox_bag_of_words_cosine_similarity_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  case WORD_EMBEDDING: {
+    const modelfox_word_embedding_feature_contribution *feature_contribution;
+    modelfox_feature_contribution_entry_as_word_embedding(entry, &feature_contribution);
+    modelfox_word_embedding_feature_contribution_get_feature_contribution_value(feature_contribution, &value);
+    break;
+  }
+  }
+  return value;
+}
+
+typedef struct {
+  float abs_value;
+  size_t index;
+} modelfox_go_ranked_entry;
+
+// Restore the min heap property of `heap` below position `i`, so that `heap[0]` is the entry with the smallest absolute value.
+static void modelfox_go_ranked_entry_sift_down(modelfox_go_ranked_entry *heap, size_t len, size_t i) {
+  for (;;) {
+    size_t smallest = i;
+    size_t left = 2 * i + 1;
+    size_t right = 2 * i + 2;
+    if (left < len && heap[left].abs_value < heap[smallest].abs_value) {
+      smallest = left;
+    }
+    if (right < len && heap[right].abs_value < heap[smallest].abs_value) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      return;
+    }
+    modelfox_go_ranked_entry tmp = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+size_t modelfox_go_feature_contributions_copy_top_entries(const modelfox_feature_contributions *feature_contributions,
+                                                          size_t len,
+                                                          size_t k,
+                                                          modelfox_go_feature_contribution_entry *entries) {
+  if (k > len) {
+    k = len;
+  }
+  if (k == 0) {
+    return 0;
+  }
+  // Keep the k largest entries seen so far in a min heap, so each entry costs O(log k) and only the values of the other entries are read.
+  modelfox_go_ranked_entry *heap = malloc(k * sizeof *heap);
+  size_t heap_len = 0;
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_feature_contribution_entry *entry;
+    modelfox_feature_contributions_get_entry_at_index(feature_contributions, i, &entry);
+    float value = modelfox_go_feature_contribution_entry_value(entry);
+    modelfox_go_ranked_entry ranked_entry = {value < 0 ? -value : value, i};
+    if (heap_len < k) {
+      heap[heap_len++] = ranked_entry;
+      if (heap_len == k) {
+        for (size_t j = k / 2; j-- > 0;) {
+          modelfox_go_ranked_entry_sift_down(heap, k, j);
+        }
+      }
+    } else if (ranked_entry.abs_value > heap[0].abs_value) {
+      heap[0] = ranked_entry;
+      modelfox_go_ranked_entry_sift_down(heap, k, 0);
+    }
+  }
+  // Pop the heap from smallest to largest, filling the entries from the back.
+  for (size_t n = k; n > 0; n--) {
+    const modelfox_feature_contribution_entry *entry;
+    modelfox_feature_contributions_get_entry_at_index(feature_contributions, heap[0].index, &entry);
+    modelfox_go_feature_contribution_entry_copy(entry, &entries[n - 1]);
+    heap[0] = heap[n - 1];
+    modelfox_go_ranked_entry_sift_down(heap, n - 1, 0);
+  }
+  free(heap);
+  return k;
+}
+
+void modelfox_go_feature_contributions_copy_values(const modelfox_feature_contributions *feature_contributions,
+                                                   size_t num_features,
+                                                   float *baseline_value,
+                                                   float *output_value,
+                                                   float *values) {
+  size_t len = 0;
+  if (feature_contributions != NULL) {
+    modelfox_feature_contributions_get_baseline_value(feature_contributions, baseline_value);
+    modelfox_feature_contributions_get_output_value(feature_contributions, output_value);
+    modelfox_feature_contributions_get_entries_len(feature_contributions, &len);
+  } else {
+    *baseline_value = 0;
+    *output_value = 0;
+  }
+  for (size_t j = 0; j < num_features; j++) {
+    if (j < len) {
+      const modelfox_feature_contribution_entry *entry;
+      modelfox_feature_contributions_get_entry_at_index(feature_contributions, j, &entry);
+      values[j] = modelfox_go_feature_contribution_entry_value(entry);
+    } else {
+      values[j] = 0;
+    }
+  }
+}
+
+void modelfox_go_predict_output_vec_get_feature_contributions(modelfox_predict_output_vec *predict_output_vec,
+                                                              modelfox_task task,
+                                                              size_t len,
+                                                              size_t num_classes,
+                                                              const modelfox_feature_contributions **feature_contributions) {
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_predict_output *predict_output;
+    size_t r = i * num_classes;
+    modelfox_predict_output_vec_get_at_index(predict_output_vec, i, &predict_output);
+    for (size_t c = 0; c < num_classes; c++) {
+      feature_contributions[r + c] = NULL;
+    }
+    switch (task) {
+    case REGRESSION: {
+      const modelfox_regression_predict_output *regression_predict_output;
+      modelfox_predict_output_as_regression(predict_output, &regression_predict_output);
+      modelfox_regression_predict_output_get_feature_contributions(regression_predict_output, &feature_contributions[r]);
+      break;
+    }
+    case BINARY_CLASSIFICATION: {
+      const modelfox_binary_classification_predict_output *binary_classification_predict_output;
+      modelfox_predict_output_as_binary_classification(predict_output, &binary_classification_predict_output);
+      modelfox_binary_classification_predict_output_get_feature_contributions(binary_classification_predict_output, &feature_contributions[r]);
+      break;
+    }
+    case MULTICLASS_CLASSIFICATION: {
+      const modelfox_multiclass_classification_predict_output *multiclass_classification_predict_output;
+      modelfox_multiclass_classification_predict_output_feature_contributions_iter *feature_contributions_iter;
+      modelfox_string_view class_name;
+      modelfox_predict_output_as_multiclass_classification(predict_output, &multiclass_classification_predict_output);
+      modelfox_multiclass_classification_predict_output_get_feature_contributions_iter(multiclass_classification_predict_output, (const modelfox_multiclass_classification_predict_output_feature_contributions_iter **)&feature_contributions_iter);
+      if (feature_contributions_iter != NULL) {
+        size_t c = 0;
+        while (c < num_classes && modelfox_multiclass_classification_predict_output_feature_contributions_iter_next(feature_contributions_iter, &class_name, &feature_contributions[r + c])) {
+          c++;
+        }
+        modelfox_multiclass_classification_predict_output_feature_contributions_iter_delete(feature_contributions_iter);
+      }
+      break;
+    }
+    }
+  }
+}
+
+void modelfox_go_predict_output_vec_copy_feature_contribution_values(modelfox_predict_output_vec *predict_output_vec,
+                                                                     modelfox_task task,
+                                                                     size_t len,
+                                                                     size_t num_classes,
+                                                                     size_t num_features,
+                                                                     float *baseline_values,
+                                                                     float *output_values,
+                                                                     float *values) {
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_predict_output *predict_output;
+    const modelfox_feature_contributions *feature_contributions = NULL;
+    modelfox_predict_output_vec_get_at_index(predict_output_vec, i, &predict_output);
+    size_t r = i * num_classes;
+    switch (task) {
+    case REGRESSION: {
+      const modelfox_regression_predict_output *regression_predict_output;
+      modelfox_predict_output_as_regression(predict_output, &regression_predict_output);
+      modelfox_regression_predict_output_get_feature_contributions(regression_predict_output, &feature_contributions);
+      modelfox_go_feature_contributions_copy_values(feature_contributions, num_features, &baseline_values[r], &output_values[r], &values[r * num_features]);
+      break;
+    }
+    case BINARY_CLASSIFICATION: {
+      const modelfox_binary_classification_predict_output *binary_classification_predict_output;
+      modelfox_predict_output_as_binary_classification(predict_output, &binary_classification_predict_output);
+      modelfox_binary_classification_predict_output_get_feature_contributions(binary_classification_predict_output, &feature_contributions);
+      modelfox_go_feature_contributions_copy_values(feature_contributions, num_features, &baseline_values[r], &output_values[r], &values[r * num_features]);
+      break;
+    }
+    case MULTICLASS_CLASSIFICATION: {
+      const modelfox_multiclass_classification_predict_output *multiclass_classification_predict_output;
+      modelfox_multiclass_classification_predict_output_feature_contributions_iter *feature_contributions_iter;
+      modelfox_string_view class_name;
+      size_t c = 0;
+      modelfox_predict_output_as_multiclass_classification(predict_output, &multiclass_classification_predict_output);
+      modelfox_multiclass_classification_predict_output_get_feature_contributions_iter(multiclass_classification_predict_output, (const modelfox_multiclass_classification_predict_output_feature_contributions_iter **)&feature_contributions_iter);
+      if (feature_contributions_iter != NULL) {
+        for (; c < num_classes && modelfox_multiclass_classification_predict_output_feature_contributions_iter_next(feature_contributions_iter, &class_name, &feature_contributions); c++) {
+          modelfox_go_feature_contributions_copy_values(feature_contributions, num_features, &baseline_values[r + c], &output_values[r + c], &values[(r + c) * num_features]);
+        }
+        modelfox_multiclass_classification_predict_output_feature_contributions_iter_delete(feature_contributions_iter);
+      }
+      for (; c < num_classes; c++) {
+        modelfox_go_feature_contributions_copy_values(NULL, num_features, &baseline_values[r + c], &output_values[r + c], &values[(r + c) * num_features]);
+      }
+      break;
+    }
+    }
+  }
+}
+
+void modelfox_go_predict_output_vec_copy_values(modelfox_predict_output_vec *predict_output_vec,
+                                                modelfox_task task,
+                                                size_t len,
+                                                const modelfox_string_view *class_names,
+                                                size_t num_class_names,
+                                                float *values,
+                                                intptr_t *class_indices) {
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_predict_output *predict_output;
+    modelfox_predict_output_vec_get_at_index(predict_output_vec, i, &predict_output);
+    modelfox_string_view class_name = {NULL, 0};
+    switch (task) {
+    case REGRESSION: {
+      const modelfox_regression_predict_output *regression_predict_output;
+      modelfox_predict_output_as_regression(predict_output, &regression_predict_output);
+      modelfox_regression_predict_output_get_value(regression_predict_output, &values[i]);
+      continue;
+    }
+    case BINARY_CLASSIFICATION: {
+      const modelfox_binary_classification_predict_output *binary_classification_predict_output;
+      modelfox_predict_output_as_binary_classification(predict_output, &binary_classification_predict_output);
+      modelfox_binary_classification_predict_output_get_probability(binary_classification_predict_output, &values[i]);
+      if (class_indices != NULL) {
+        modelfox_binary_classification_predict_output_get_class_name(binary_classification_predict_output, &class_name);
+      }
+      break;
+    }
+    case MULTICLASS_CLASSIFICATION: {
+      const modelfox_multiclass_classification_predict_output *multiclass_classification_predict_output;
+      modelfox_predict_output_as_multiclass_classification(predict_output, &multiclass_classification_predict_output);
+      modelfox_multiclass_classification_predict_output_get_probability(multiclass_classification_predict_output, &values[i]);
+      if (class_indices != NULL) {
+        modelfox_multiclass_classification_predict_output_get_class_name(multiclass_classification_predict_output, &class_name);
+      }
+      break;
+    }
+    }
+    if (class_indices != NULL) {
+      class_indices[i] = modelfox_go_class_index(class_names, num_class_names, class_name);
+    }
+  }
+}
+
+void modelfox_go_predict_output_vec_copy_probabilities(modelfox_predict_output_vec *predict_output_vec,
+                                                       size_t len,
+                                                       size_t num_classes,
+                                                       float *probabilities) {
+  for (size_t i = 0; i < len; i++) {
+    const modelfox_predict_output *predict_output;
+    const modelfox_multiclass_classification_predict_output *multiclass_classification_predict_output;
+    modelfox_multiclass_classification_predict_output_probabilities_iter *probabilities_iter;
+    modelfox_string_view class_name;
+    modelfox_predict_output_vec_get_at_index(predict_output_vec, i, &predict_output);
+    modelfox_predict_output_as_multiclass_classification(predict_output, &multiclass_classification_predict_output);
+    modelfox_multiclass_classification_predict_output_get_probabilities_iter(multiclass_classification_predict_output, (const modelfox_multiclass_classification_predict_output_probabilities_iter **)&probabilities_iter);
+    float *row = probabilities + i * num_classes;
+    for (size_t j = 0; j < num_classes && modelfox_multiclass_classification_predict_output_probabilities_iter_next(probabilities_iter, &class_name, &row[j]); j++) {
+    }
+    modelfox_multiclass_classification_predict_output_probabilities_iter_delete(probabilities_iter);
+  }
+}
@@ -0,0 +1,126 @@
+/** This header file defines helpers used by the Go bindings to make many libmodelfox calls with a single cgo call. The helpers keep no state of their own, so they may be called from many threads at once, as long as each thread passes its own predict inputs and outputs. A `modelfox_model` is never modified after it is loaded, so it may be shared by all threads. */
+
+#pragma once
+
+#include "modelfox.h"
+
+/// A `modelfox_go_value_kind` identifies the kind of a value passed to `modelfox_go_predict_input_vec_push_rows`.
+typedef enum {
+  MODELFOX_GO_VALUE_NONE,
+  MODELFOX_GO_VALUE_NUMBER,
+  MODELFOX_GO_VALUE_STRING,
+} modelfox_go_value_kind;
+
+/// Load a model from the file at `path`, like `modelfox_model_from_path`. `path` does not need to be nul terminated, so Go strings can be passed without being copied.
+modelfox_error *modelfox_go_model_from_path(modelfox_string_view path,
+                                            const modelfox_model **model_ptr);
+
+/// A `modelfox_go_feature_contribution_entry` holds every field of a feature contribution entry, so that all of the entries of a `modelfox_feature_contributions` value can be copied with a single call. Which fields are set depends on `type`. For bag of words cosine similarity entries, `column_name` and `column_name_b` are the names of columns a and b. For one hot encoded entries, `feature_value` is 1 if the feature is present and 0 otherwise. The string views point into the feature contributions and are valid for as long as they are.
+typedef struct {
+  modelfox_feature_contribution_entry_type type;
+  modelfox_ngram_type ngram_type;
+  float feature_value;
+  float feature_contribution_value;
+  size_t value_index;
+  modelfox_string_view column_name;
+  modelfox_string_view column_name_b;
+  modelfox_string_view variant;
+  modelfox_string_view token_a;
+  modelfox_string_view token_b;
+} modelfox_go_feature_contribution_entry;
+
+/// Create `len` new predict inputs and write them to `predict_inputs`, which must have room for `len` pointers.
+void modelfox_go_predict_inputs_new(modelfox_predict_input **predict_inputs,
+                                    size_t len);
+
+/// Set the value of column `column_name` to the number `values[i]` on each of the `len` predict inputs.
+modelfox_error *modelfox_go_predict_inputs_set_number_column(modelfox_predict_input **predict_inputs,
+                                                             size_t len,
+                                                             modelfox_string_view column_name,
+                                                             const double *values);
+
+/// Set the value of column `column_name` to the string `data[offsets[i]..offsets[i + 1]]` on each of the `len` predict inputs. `offsets` must have `len + 1` entries.
+modelfox_error *modelfox_go_predict_inputs_set_string_column(modelfox_predict_input **predict_inputs,
+                                                             size_t len,
+                                                             modelfox_string_view column_name,
+                                                             const char *data,
+                                                             const size_t *offsets);
+
+/// Add each of the `len` predict inputs to the predict input vec.
+void modelfox_go_predict_input_vec_push_all(modelfox_predict_input_vec *predict_input_vec,
+                                            modelfox_predict_input **predict_inputs,
+                                            size_t len);
+
+/// Create a predict input for each of the `len` rows and add it to the predict input vec. The values for row `i` and column `column_names[j]` are at index `i * num_columns + j` of `kinds`, `numbers`, and `string_offsets`. If the kind is `MODELFOX_GO_VALUE_NUMBER`, the value is the number in `numbers`. If the kind is `MODELFOX_GO_VALUE_STRING`, the value is the string `string_data[string_offsets[k]..string_offsets[k + 1]]`. If the kind is `MODELFOX_GO_VALUE_NONE`, the column is left unset. `string_offsets` must have `len * num_columns + 1` entries.
+modelfox_error *modelfox_go_predict_input_vec_push_rows(modelfox_predict_input_vec *predict_input_vec,
+                                                        const char *const *column_names,
+                                                        size_t num_columns,
+                                                        size_t len,
+                                                        const uint8_t *kinds,
+                                                        const double *numbers,
+                                                        const char *string_data,
+                                                        const size_t *string_offsets);
+
+/// Create a predict input for each of the `len` rows and add it to the predict input vec. Row `i` has `row_lens[i]` values, and the values of all rows are numbered consecutively. Value `k` is for the column named `data[offsets[2 * k]..offsets[2 * k + 1]]`. If its kind is `MODELFOX_GO_VALUE_NUMBER`, the value is the number in `numbers[k]`. If its kind is `MODELFOX_GO_VALUE_STRING`, the value is the string `data[offsets[2 * k + 1]..offsets[2 * k + 2]]`. If its kind is `MODELFOX_GO_VALUE_NONE`, the column is left unset. `offsets` must have two entries per value plus one.
+modelfox_error *modelfox_go_predict_input_vec_push_maps(modelfox_predict_input_vec *predict_input_vec,
+                                                        size_t len,
+                                                        const size_t *row_lens,
+                                                        const uint8_t *kinds,
+                                                        const double *numbers,
+                                                        const char *data,
+                                                        const size_t *offsets);
+
+/// Copy the first `len` entries of the feature contributions to `entries`.
+void modelfox_go_feature_contributions_copy_entries(const modelfox_feature_contributions *feature_contributions,
+                                                    size_t len,
+                                                    modelfox_go_feature_contribution_entry *entries);
+
+/// Copy the `k` entries of the feature contributions with the largest absolute feature contribution values to `entries`, in descending order of absolute value. The entries are selected with a partial selection over the `len` entries, and only the selected entries are copied. The number of entries copied, which is less than `k` if there are fewer than `k` entries, is returned.
+size_t modelfox_go_feature_contributions_copy_top_entries(const modelfox_feature_contributions *feature_contributions,
+                                                          size_t len,
+                                                          size_t k,
+                                                          modelfox_go_feature_contribution_entry *entries);
+
+/// Copy entry `index` of the feature contributions to `entry`.
+void modelfox_go_feature_contributions_copy_entry(const modelfox_feature_contributions *feature_contributions,
+                                                  size_t index,
+                                                  modelfox_go_feature_contribution_entry *entry);
+
+/// Write the baseline value of the feature contributions to `baseline_value`, the output value to `output_value`, and the first `num_features` feature contribution values to `values`. Missing values are written as zero, and so is every value if `feature_contributions` is null.
+void modelfox_go_feature_contributions_copy_values(const modelfox_feature_contributions *feature_contributions,
+                                                   size_t num_features,
+                                                   float *baseline_value,
+                                                   float *output_value,
+                                                   float *values);
+
+/// Write the feature contributions of each of the `len` predict outputs in the predict output vec to `feature_contributions`. Each output has `num_classes` feature contributions, one for regression and binary classification and one per class for multiclass classification, in the model's class order. Feature contributions `c` of output `i` are written to `feature_contributions[i * num_classes + c]`, or null if the output has none. The pointers are valid for as long as the predict output vec.
+void modelfox_go_predict_output_vec_get_feature_contributions(modelfox_predict_output_vec *predict_output_vec,
+                                                              modelfox_task task,
+                                                              size_t len,
+                                                              size_t num_classes,
+                                                              const modelfox_feature_contributions **feature_contributions);
+
+/// Copy the feature contribution values of each of the `len` predict outputs in the predict output vec, which must have been computed with feature contributions. Each output has `num_classes` feature contributions, one for regression and binary classification and one per class for multiclass classification, in the model's class order. For feature contributions `c` of output `i`, with `r = i * num_classes + c`, the baseline value is written to `baseline_values[r]`, the output value to `output_values[r]`, and the first `num_features` feature contribution values to `values[r * num_features..(r + 1) * num_features]`. Missing values are written as zero.
+void modelfox_go_predict_output_vec_copy_feature_contribution_values(modelfox_predict_output_vec *predict_output_vec,
+                                                                     modelfox_task task,
+                                                                     size_t len,
+                                                                     size_t num_classes,
+                                                                     size_t num_features,
+                                                                     float *baseline_values,
+                                                                     float *output_values,
+                                                                     float *values);
+
+/// Copy the value of each of the `len` predict outputs in the predict output vec to `values`. For regression, the value is the predicted value. For classification, the value is the probability of the predicted class, and the index of the predicted class in `class_names` is written to `class_indices`, or -1 if `class_names` does not contain it. `class_indices` may be null if the class indices are not needed.
+void modelfox_go_predict_output_vec_copy_values(modelfox_predict_output_vec *predict_output_vec,
+                                                modelfox_task task,
+                                                size_t len,
+                                                const modelfox_string_view *class_names,
+                                                size_t num_class_names,
+                                                float *values,
+                                                intptr_t *class_indices);
+
+/// Write the probabilities of the `len` multiclass classification predict outputs in the predict output vec to `probabilities` as a row major matrix with `num_classes` columns, with the classes in the model's order.
+void modelfox_go_predict_output_vec_copy_probabilities(modelfox_predict_output_vec *predict_output_vec,
+                                                       size_t len,
+                                                       size_t num_classes,
+                                                       float *probabilities);
@@ -0,0 +1,256 @@
+package modelfox
+
+import (
+	"errors"
+	"log"
+	"net/http"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// LogQueueFullPolicy determines what happens when an event is logged while the log queue is full, one of LogQueueFullDrop and LogQueueFullBlock.
+type LogQueueFullPolicy int
+
+const (
+	// LogQueueFullDrop drops the event, so that logging never slows down predictions. The number of dropped events is available from `model.DroppedLogEvents`.
+	LogQueueFullDrop LogQueueFullPolicy = iota
+	// LogQueueFullBlock waits until there is room in the queue, so that no events are lost.
+	LogQueueFullBlock
+)
+
+const (
+	defaultLogQueueSize      = 10000
+	defaultLogBatchSize      = 100
+	defaultLogFlushInterval  = time.Second
+	defaultLogRequestTimeout = 10 * time.Second
+	// A batch buffer larger than this is not kept for the next batch.
+	maxRetainedLogBatchLen = 1 << 22
+)
+
+// A logResponseError is returned when the app responds to a batch of events with an error status.
+type logResponseError struct {
+	statusCode int
+	message    string
+}
+
+func (e *logResponseError) Error() string {
+	return e.message
+}
+
+// Determine whether a batch that failed to send with `err` should be sent again. Only network errors and server errors can succeed on retry. The app rejects a batch with any other status because of its contents, so it would reject the same batch forever.
+func isRetryableLogError(err error) bool {
+	var responseErr *logResponseError
+	if errors.As(err, &responseErr) {
+		return responseErr.statusCode >= http.StatusInternalServerError
+	}
+	return true
+}
+
+// An eventLogger sends events to the app from a background goroutine. Any number of goroutines add events to a bounded queue, and the background goroutine is the queue's only consumer. It encodes each event as it takes it from the queue, and sends the encoded events in batches when a batch is full, when the flush interval elapses if background logging is enabled, when `flush` is called, and when the logger is closed. An event that cannot be encoded is dropped on its own. If sending fails with a network or server error, the batch is kept and retried with the next flush, and events wait in the queue until there is room for them again. If the app rejects the batch, it is dropped.
+type eventLogger struct {
+	queue         chan event
+	flushRequests chan chan error
+	stop          chan struct{}
+	done          chan struct{}
+	startOnce     sync.Once
+	started       uint32
+	batchSize     int
+	flushInterval time.Duration
+	policy        LogQueueFullPolicy
+	send          func(body []byte, numEvents int) error
+	handleError   func(error)
+	dropped       uint64
+}
+
+func newEventLogger(options *LoadModelOptions, send func(body []byte, numEvents int) error) *eventLogger {
+	l := eventLogger{
+		flushRequests: make(chan chan error),
+		stop:          make(chan struct{}),
+		done:          make(chan struct{}),
+		batchSize:     defaultLogBatchSize,
+		policy:        options.LogQueueFullPolicy,
+		send:          send,
+		handleError:   options.LogErrorHandler,
+	}
+	queueSize := defaultLogQueueSize
+	if options.LogQueueSize > 0 {
+		queueSize = options.LogQueueSize
+	}
+	if options.LogBatchSize > 0 {
+		l.batchSize = options.LogBatchSize
+	}
+	if options.BackgroundLogging {
+		l.flushInterval = defaultLogFlushInterval
+		if options.LogFlushInterval > 0 {
+			l.flushInterval = options.LogFlushInterval
+		}
+	}
+	if l.handleError == nil {
+		l.handleError = func(err error) {
+			log.Println("modelfox: failed to log events:", err)
+		}
+	}
+	l.queue = make(chan event, queueSize)
+	return &l
+}
+
+// The background goroutine is started the first time an event is logged, so models that never log events do not have one.
+func (l *eventLogger) start() {
+	l.startOnce.Do(func() {
+		atomic.StoreUint32(&l.started, 1)
+		go l.run()
+	})
+}
+
+// Add an event to the queue, following the queue full policy if there is no room for it.
+func (l *eventLogger) enqueue(e event) {
+	l.start()
+	if l.policy == LogQueueFullBlock {
+		select {
+		case l.queue <- e:
+		case <-l.stop:
+			atomic.AddUint64(&l.dropped, 1)
+		}
+		return
+	}
+	select {
+	case l.queue <- e:
+	default:
+		atomic.AddUint64(&l.dropped, 1)
+	}
+}
+
+// Send every queued event and wait for the result.
+func (l *eventLogger) flush() error {
+	l.start()
+	reply := make(chan error, 1)
+	select {
+	case l.flushRequests <- reply:
+		return <-reply
+	case <-l.done:
+		return nil
+	}
+}
+
+func (l *eventLogger) run() {
+	defer close(l.done)
+	var tick <-chan time.Time
+	if l.flushInterval > 0 {
+		ticker := time.NewTicker(l.flushInterval)
+		defer ticker.Stop()
+		tick = ticker.C
+	}
+	// At most one queue's worth of events is taken out of the queue at a time, so memory stays bounded while the app is unreachable.
+	maxPending := cap(l.queue)
+	if maxPending < l.batchSize {
+		maxPending = l.batchSize
+	}
+	pending := eventBatch{}
+	pending.reset()
+	failed := false
+	add := func(e *event) {
+		if err := pending.add(e); err != nil {
+			atomic.AddUint64(&l.dropped, 1)
+			l.handleError(err)
+		}
+	}
+	send := func() error {
+		if pending.len == 0 {
+			return nil
+		}
+		err := l.send(pending.bytes(), pending.len)
+		if err != nil && isRetryableLogError(err) {
+			failed = true
+			return err
+		}
+		if err != nil {
+			atomic.AddUint64(&l.dropped, uint64(pending.len))
+		}
+		failed = false
+		pending.reset()
+		return err
+	}
+	drain := func() {
+		for pending.len < maxPending {
+			select {
+			case e := <-l.queue:
+				add(&e)
+			default:
+				return
+			}
+		}
+	}
+	for {
+		queue := l.queue
+		if pending.len >= maxPending {
+			queue = nil
+		}
+		select {
+		case e := <-queue:
+			add(&e)
+			// After a failure, wait for the next flush instead of retrying on every event.
+			if pending.len >= l.batchSize && !failed {
+				if err := send(); err != nil {
+					l.handleError(err)
+				}
+			}
+		case <-tick:
+			if err := send(); err != nil {
+				l.handleError(err)
+			}
+		case reply := <-l.flushRequests:
+			drain()
+			reply <- send()
+		case <-l.stop:
+			drain()
+			if err := send(); err != nil {
+				l.handleError(err)
+			}
+			return
+		}
+	}
+}
+
+// Stop the background goroutine after sending every queued event.
+func (l *eventLogger) close() {
+	close(l.stop)
+	if atomic.LoadUint32(&l.started) == 1 {
+		<-l.done
+	}
+}
+
+// An eventBatch holds the JSON encoding of a batch of events, as an array that is missing its closing bracket.
+type eventBatch struct {
+	body []byte
+	len  int
+}
+
+// Encode `e` and add it to the batch. If it cannot be encoded, the batch is left unchanged.
+func (b *eventBatch) add(e *event) error {
+	start := len(b.body)
+	if b.len > 0 {
+		b.body = append(b.body, ',')
+	}
+	body, err := appendEventJSON(b.body, e)
+	if err != nil {
+		b.body = b.body[:start]
+		return err
+	}
+	b.body = body
+	b.len++
+	return nil
+}
+
+// Retrieve the JSON array of the events in the batch.
+func (b *eventBatch) bytes() []byte {
+	return append(b.body, ']')
+}
+
+func (b *eventBatch) reset() {
+	if cap(b.body) > maxRetainedLogBatchLen {
+		b.body = nil
+	}
+	b.body = append(b.body[:0], '[')
+	b.len = 0
+}
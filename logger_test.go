@@ -0,0 +1,254 @@
+package modelfox
+
+import (
+	"bytes"
+	"compress/gzip"
+	"encoding/json"
+	"io"
+	"math"
+	"net/http"
+	"net/http/httptest"
+	"strconv"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// A testApp stands in for the app's `/track` endpoint. It records the events it accepts, and responds with `status` to every request. Batches with an event whose identifier is "rejected" are always rejected with a 400 response.
+type testApp struct {
+	*httptest.Server
+	status int32
+	mutex  sync.Mutex
+	events []map[string]interface{}
+}
+
+func newTestApp() *testApp {
+	app := testApp{status: http.StatusOK}
+	app.Server = httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		status := int(atomic.LoadInt32(&app.status))
+		if status != http.StatusOK {
+			http.Error(w, http.StatusText(status), status)
+			return
+		}
+		var body io.Reader = r.Body
+		if r.Header.Get("Content-Encoding") == "gzip" {
+			gz, err := gzip.NewReader(r.Body)
+			if err != nil {
+				http.Error(w, err.Error(), http.StatusBadRequest)
+				return
+			}
+			body = gz
+		}
+		var events []map[string]interface{}
+		if err := json.NewDecoder(body).Decode(&events); err != nil {
+			http.Error(w, err.Error(), http.StatusBadRequest)
+			return
+		}
+		for _, event := range events {
+			if event["identifier"] == "rejected" {
+				http.Error(w, "rejected", http.StatusBadRequest)
+				return
+			}
+		}
+		app.mutex.Lock()
+		defer app.mutex.Unlock()
+		app.events = append(app.events, events...)
+	}))
+	return &app
+}
+
+func (app *testApp) setStatus(status int) {
+	atomic.StoreInt32(&app.status, int32(status))
+}
+
+func (app *testApp) receivedEvents() []map[string]interface{} {
+	app.mutex.Lock()
+	defer app.mutex.Unlock()
+	return append([]map[string]interface{}{}, app.events...)
+}
+
+// Create a model that only logs events, so that logging can be tested without a model file. Call `model.stopLogging` instead of `model.Destroy` when done.
+func newLoggingTestModel(t *testing.T, options LoadModelOptions) *Model {
+	t.Helper()
+	model := &Model{
+		id:      "test_model",
+		options: &options,
+		sampler: newLogSampler(&options),
+	}
+	if err := model.startLogging(); err != nil {
+		t.Fatal(err)
+	}
+	return model
+}
+
+func TestBackgroundLogging(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL:       app.URL,
+		BackgroundLogging: true,
+		LogBatchSize:      10,
+	})
+	input := PredictInput{}
+	for i := 0; i < 100; i++ {
+		input["x"] = float64(i)
+		err := model.LogPrediction(LogPredictionArgs{
+			Identifier: strconv.Itoa(i),
+			Input:      input,
+			Output:     RegressionPredictOutput{Value: float32(i)},
+		})
+		if err != nil {
+			t.Fatal(err)
+		}
+		// The input is reused right away, while the event may still be waiting in the queue.
+		input["x"] = -1.0
+	}
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	model.stopLogging()
+	events := app.receivedEvents()
+	if len(events) != 100 {
+		t.Fatalf("the app received %d events, expected 100", len(events))
+	}
+	for _, event := range events {
+		identifier := event["identifier"].(string)
+		x := event["input"].(map[string]interface{})["x"].(float64)
+		if strconv.Itoa(int(x)) != identifier {
+			t.Fatalf("event %s was logged with input %v", identifier, x)
+		}
+	}
+}
+
+func TestLoggerDropsEventsThatCannotBeSent(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	var handled []error
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL: app.URL,
+		LogErrorHandler: func(err error) {
+			handled = append(handled, err)
+		},
+	})
+	defer model.stopLogging()
+	enqueue := func(identifier string, x float64) {
+		model.EnqueueLogPrediction(LogPredictionArgs{
+			Identifier: identifier,
+			Input:      PredictInput{"x": x},
+			Output:     RegressionPredictOutput{Value: 1},
+		})
+	}
+	// An event that cannot be encoded is dropped without holding back the rest of its batch.
+	enqueue("a", 1)
+	enqueue("nan", math.NaN())
+	enqueue("b", 2)
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	if len(app.receivedEvents()) != 2 || model.DroppedLogEvents() != 1 || len(handled) != 1 {
+		t.Fatalf("received %d events, dropped %d, handled %d errors", len(app.receivedEvents()), model.DroppedLogEvents(), len(handled))
+	}
+	// A batch the app rejects is dropped, and only the flush that sent it fails.
+	app.setStatus(http.StatusBadRequest)
+	enqueue("c", 3)
+	enqueue("d", 4)
+	if err := model.FlushLogQueue(); err == nil {
+		t.Fatal("expected the rejected batch to fail the flush")
+	}
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	if model.DroppedLogEvents() != 3 {
+		t.Fatalf("dropped %d events, expected 3", model.DroppedLogEvents())
+	}
+	// A batch that fails with a server error is kept and sent again.
+	app.setStatus(http.StatusServiceUnavailable)
+	enqueue("e", 5)
+	if err := model.FlushLogQueue(); err == nil {
+		t.Fatal("expected the server error to fail the flush")
+	}
+	if err := model.FlushLogQueue(); err == nil {
+		t.Fatal("expected the batch to be kept after the server error")
+	}
+	app.setStatus(http.StatusOK)
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	if len(app.receivedEvents()) != 3 || model.DroppedLogEvents() != 3 {
+		t.Fatalf("received %d events, dropped %d", len(app.receivedEvents()), model.DroppedLogEvents())
+	}
+}
+
+func TestCompressedLogging(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	model := newLoggingTestModel(t, LoadModelOptions{ModelFoxURL: app.URL, CompressLogs: true})
+	defer model.stopLogging()
+	for i := 0; i < 10; i++ {
+		err := model.LogTrueValue(LogTrueValueArgs{Identifier: strconv.Itoa(i), TrueValue: "Positive"})
+		if err != nil {
+			t.Fatal(err)
+		}
+	}
+	if len(app.receivedEvents()) != 10 {
+		t.Fatalf("the app received %d events, expected 10", len(app.receivedEvents()))
+	}
+}
+
+// The app may respond before reading the whole body, and the HTTP client may keep sending it after that. Run with `go test -race` to check that request buffers are not reused while they are being sent.
+func TestPostEventsEarlyResponse(t *testing.T) {
+	app := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		w.WriteHeader(http.StatusRequestEntityTooLarge)
+	}))
+	defer app.Close()
+	for _, compress := range []bool{false, true} {
+		model := newLoggingTestModel(t, LoadModelOptions{ModelFoxURL: app.URL, CompressLogs: compress})
+		// The same buffer is reused for every batch, as the logger does.
+		body := make([]byte, 1<<20)
+		for i := 0; i < 20; i++ {
+			copy(body, bytes.Repeat([]byte{byte('a' + i)}, len(body)))
+			if err := model.postEvents(body); err == nil {
+				t.Fatal("expected the app to reject the batch")
+			}
+		}
+		model.stopLogging()
+	}
+}
+
+func TestUnresponsiveApp(t *testing.T) {
+	release := make(chan struct{})
+	app := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
+		<-release
+	}))
+	defer app.Close()
+	defer close(release)
+	const timeout = 200 * time.Millisecond
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL:       app.URL,
+		BackgroundLogging: true,
+		LogRequestTimeout: timeout,
+		LogErrorHandler:   func(error) {},
+	})
+	logged := make(chan struct{})
+	go func() {
+		defer close(logged)
+		for i := 0; i < 10; i++ {
+			model.LogTrueValue(LogTrueValueArgs{Identifier: strconv.Itoa(i), TrueValue: "Positive"})
+		}
+	}()
+	select {
+	case <-logged:
+	case <-time.After(time.Second):
+		t.Fatal("logging in the background waited for the app")
+	}
+	start := time.Now()
+	if err := model.FlushLogQueue(); err == nil {
+		t.Fatal("expected the flush to time out")
+	}
+	model.stopLogging()
+	// The flush and the final send each wait at most one request timeout.
+	if elapsed := time.Since(start); elapsed > 10*timeout {
+		t.Fatalf("flushing and stopping took %v with a request timeout of %v", elapsed, timeout)
+	}
+}
@@ -0,0 +1,83 @@
+package modelfox
+
+// #include "helpers.h"
+import "C"
+
+import (
+	"sync"
+	"sync/atomic"
+)
+
+// A nameTable interns the column names, enum variants, and tokens in a model's feature contributions. These all come from the model's fixed set of features, so the table stops growing once every feature has been seen, and from then on decoding feature contributions does not allocate any strings. Like a classTable, lookups are lock free and read an immutable snapshot, and only adding names takes the lock.
+type nameTable struct {
+	mutex sync.Mutex
+	// This holds a map[string]string that is never modified after it is stored.
+	names atomic.Value
+}
+
+func newNameTable() *nameTable {
+	t := nameTable{}
+	t.names.Store(map[string]string{})
+	return &t
+}
+
+func (t *nameTable) load() map[string]string {
+	return t.names.Load().(map[string]string)
+}
+
+// Add `names` to the table. Each snapshot is a full copy of the table, so this costs time proportional to the size of the table, and callers add names in batches instead of one at a time.
+func (t *nameTable) add(names map[string]string) {
+	t.mutex.Lock()
+	defer t.mutex.Unlock()
+	oldNames := t.load()
+	newNames := make(map[string]string, len(oldNames)+len(names))
+	for name := range oldNames {
+		newNames[name] = name
+	}
+	for name := range names {
+		if _, ok := newNames[name]; !ok {
+			newNames[name] = name
+		}
+	}
+	t.names.Store(newNames)
+}
+
+// Start a batch that interns the names of one prediction call.
+func (t *nameTable) batch() nameBatch {
+	return nameBatch{table: t, names: t.load()}
+}
+
+// A nameBatch interns the names decoded by one prediction call. Names that are not in the table yet are kept in the batch and added to the table with a single snapshot by `publish`, so a batch of outputs copies the table at most once however many of them bring new names. A nameBatch must not be used by more than one goroutine at a time.
+type nameBatch struct {
+	table   *nameTable
+	names   map[string]string
+	pending map[string]string
+}
+
+// Retrieve the interned copy of the string `sv`.
+func (b *nameBatch) intern(sv C.modelfox_string_view) string {
+	if sv.len == 0 {
+		return ""
+	}
+	if name, ok := b.names[string(stringViewBytes(sv))]; ok {
+		return name
+	}
+	if name, ok := b.pending[string(stringViewBytes(sv))]; ok {
+		return name
+	}
+	if b.pending == nil {
+		b.pending = make(map[string]string)
+	}
+	name := string(stringViewBytes(sv))
+	b.pending[name] = name
+	return name
+}
+
+// Add the names that were not in the table to it.
+func (b *nameBatch) publish() {
+	if len(b.pending) > 0 {
+		b.table.add(b.pending)
+		b.names = b.table.load()
+		b.pending = nil
+	}
+}
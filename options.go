@@ -0,0 +1,57 @@
+package modelfox
+
+// #include "helpers.h"
+import "C"
+
+import (
+	"sync"
+	"sync/atomic"
+)
+
+// This is the most distinct predict options a model keeps handles for. Predictions with any other options create and delete a handle for each call, as they did before handles were cached.
+const maxCachedPredictOptions = 64
+
+// A predictOptionsCache keeps a libmodelfox predict options handle for each distinct set of predict options used with a model, so predictions do not create and delete one on every call. A handle is never modified after it is added to the cache, so it is shared by concurrent predictions without a lock.
+type predictOptionsCache struct {
+	handles sync.Map
+	len     int32
+}
+
+type predictOptionsKey struct {
+	// A zero threshold is not passed to libmodelfox, so nil options share a handle with options that only set Go settings like `NumThreads`.
+	threshold                   float32
+	computeFeatureContributions bool
+}
+
+// Retrieve the handle for `options`. If the second return value is true, the handle is not cached and the caller must delete it.
+func (c *predictOptionsCache) get(options *PredictOptions) (*C.modelfox_predict_options, bool) {
+	key := predictOptionsKey{}
+	if options != nil {
+		key = predictOptionsKey{
+			threshold:                   options.Threshold,
+			computeFeatureContributions: options.ComputeFeatureContributions,
+		}
+	}
+	if cOptions, ok := c.handles.Load(key); ok {
+		return cOptions.(*C.modelfox_predict_options), false
+	}
+	cOptions := newPredictOptions(options)
+	if atomic.LoadInt32(&c.len) >= maxCachedPredictOptions {
+		return cOptions, true
+	}
+	if cached, loaded := c.handles.LoadOrStore(key, cOptions); loaded {
+		C.modelfox_predict_options_delete(cOptions)
+		return cached.(*C.modelfox_predict_options), false
+	}
+	atomic.AddInt32(&c.len, 1)
+	return cOptions, false
+}
+
+func (c *predictOptionsCache) destroy() {
+	c.handles.Range(func(key, cOptions interface{}) bool {
+		C.modelfox_predict_options_delete(cOptions.(*C.modelfox_predict_options))
+		c.handles.Delete(key)
+		return true
+	})
+	atomic.StoreInt32(&c.len, 0)
+}
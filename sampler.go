@@ -0,0 +1,83 @@
+package modelfox
+
+import (
+	"math"
+	"sync"
+	"time"
+)
+
+// A logSampler decides which events are logged. Sampling is deterministic on the event's identifier, so a prediction and the true value logged later with the same identifier are either both kept or both dropped. Events that are kept by sampling then pass through an optional token bucket that limits the rate of logged events.
+type logSampler struct {
+	// An event is kept if the hash of its identifier is less than this threshold, unless `all` is set.
+	threshold uint64
+	all       bool
+	limiter   *tokenBucket
+}
+
+func newLogSampler(options *LoadModelOptions) *logSampler {
+	s := logSampler{all: true}
+	if options.LogSampleRate > 0 && options.LogSampleRate < 1 {
+		s.all = false
+		s.threshold = uint64(options.LogSampleRate * math.MaxUint64)
+	}
+	if options.LogRateLimit > 0 {
+		burst := float64(options.LogRateBurst)
+		if burst < 1 {
+			burst = math.Max(1, math.Ceil(options.LogRateLimit))
+		}
+		s.limiter = &tokenBucket{
+			rate:   options.LogRateLimit,
+			burst:  burst,
+			tokens: burst,
+			last:   time.Now(),
+		}
+	}
+	return &s
+}
+
+// Determine whether the event with `identifier` is sampled. This does not take a token from the rate limiter.
+func (s *logSampler) sampled(identifier string) bool {
+	if s.all {
+		return true
+	}
+	// This is FNV-1a, inlined so that sampling does not allocate.
+	hash := uint64(14695981039346656037)
+	for i := 0; i < len(identifier); i++ {
+		hash ^= uint64(identifier[i])
+		hash *= 1099511628211
+	}
+	// FNV-1a mixes the last bytes of the identifier poorly into the high bits that the threshold compares, so identifiers that differ only in a counter suffix would be sampled at the wrong rate. The splitmix64 finalizer spreads every bit of the hash over the whole word.
+	hash ^= hash >> 30
+	hash *= 0xbf58476d1ce4e5b9
+	hash ^= hash >> 27
+	hash *= 0x94d049bb133111eb
+	hash ^= hash >> 31
+	return hash < s.threshold
+}
+
+// Determine whether the event fits in the rate limit, taking a token from the bucket if it does.
+func (s *logSampler) allowed() bool {
+	return s.limiter == nil || s.limiter.take()
+}
+
+// A tokenBucket allows `rate` events per second on average, and bursts of up to `burst` events.
+type tokenBucket struct {
+	mutex  sync.Mutex
+	rate   float64
+	burst  float64
+	tokens float64
+	last   time.Time
+}
+
+func (b *tokenBucket) take() bool {
+	b.mutex.Lock()
+	defer b.mutex.Unlock()
+	now := time.Now()
+	b.tokens = math.Min(b.burst, b.tokens+now.Sub(b.last).Seconds()*b.rate)
+	b.last = now
+	if b.tokens < 1 {
+		return false
+	}
+	b.tokens--
+	return true
+}
@@ -0,0 +1,123 @@
+package modelfox
+
+import (
+	"fmt"
+	"math"
+	"strconv"
+	"testing"
+	"time"
+)
+
+func TestSamplingKeepsPredictionsAndTrueValuesTogether(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	model := newLoggingTestModel(t, LoadModelOptions{ModelFoxURL: app.URL, LogSampleRate: 0.3})
+	defer model.stopLogging()
+	for i := 0; i < 1000; i++ {
+		identifier := "req-" + strconv.Itoa(i)
+		model.EnqueueLogPrediction(LogPredictionArgs{
+			Identifier: identifier,
+			Input:      PredictInput{"x": float64(i)},
+			Output:     RegressionPredictOutput{Value: 1},
+		})
+		model.EnqueueLogTrueValue(LogTrueValueArgs{Identifier: identifier, TrueValue: 1.0})
+	}
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	predictions := map[string]bool{}
+	trueValues := map[string]bool{}
+	for _, event := range app.receivedEvents() {
+		identifier := event["identifier"].(string)
+		if event["type"] == predictionEventType {
+			predictions[identifier] = true
+		} else {
+			trueValues[identifier] = true
+		}
+	}
+	if len(predictions) == 0 || len(predictions) == 1000 {
+		t.Fatalf("sampled %d of 1000 predictions", len(predictions))
+	}
+	if len(predictions) != len(trueValues) {
+		t.Fatalf("sampled %d predictions and %d true values", len(predictions), len(trueValues))
+	}
+	for identifier := range predictions {
+		if !trueValues[identifier] {
+			t.Fatalf("the prediction %s was sampled without its true value", identifier)
+		}
+	}
+}
+
+func TestSampleRate(t *testing.T) {
+	identifierFormats := map[string]func(int) string{
+		"counter": func(i int) string {
+			return "req-" + strconv.Itoa(i)
+		},
+		"uuid": func(i int) string {
+			// Spread the counter over the digits the way random UUIDs are, with a fixed version and variant.
+			x := uint64(i) * 0x9e3779b97f4a7c15
+			return fmt.Sprintf("%08x-%04x-4%03x-a%03x-%012x", x>>32, x>>16&0xffff, x>>4&0xfff, x&0xfff, uint64(i))
+		},
+	}
+	const n = 100000
+	for name, identifier := range identifierFormats {
+		for _, rate := range []float64{0.01, 0.1, 0.5, 0.9} {
+			sampler := newLogSampler(&LoadModelOptions{LogSampleRate: rate})
+			sampled := 0
+			for i := 0; i < n; i++ {
+				if sampler.sampled(identifier(i)) {
+					sampled++
+				}
+			}
+			// This allows more than five standard deviations of the binomial distribution.
+			tolerance := 5*math.Sqrt(rate*(1-rate)/n) + 0.001
+			if observed := float64(sampled) / n; math.Abs(observed-rate) > tolerance {
+				t.Errorf("%s identifiers were sampled at %.4f with a sample rate of %v", name, observed, rate)
+			}
+		}
+	}
+}
+
+func TestRateLimit(t *testing.T) {
+	sampler := newLogSampler(&LoadModelOptions{LogRateLimit: 10, LogRateBurst: 5})
+	taken := 0
+	for i := 0; i < 100; i++ {
+		if sampler.allowed() {
+			taken++
+		}
+	}
+	if taken != 5 {
+		t.Fatalf("allowed a burst of %d events, expected 5", taken)
+	}
+	// Move the bucket's clock back instead of sleeping, so the test does not depend on the scheduler.
+	refill := func(elapsed time.Duration) {
+		sampler.limiter.mutex.Lock()
+		defer sampler.limiter.mutex.Unlock()
+		sampler.limiter.last = sampler.limiter.last.Add(-elapsed)
+	}
+	refill(300 * time.Millisecond)
+	taken = 0
+	for i := 0; i < 100; i++ {
+		if sampler.allowed() {
+			taken++
+		}
+	}
+	if taken != 3 {
+		t.Fatalf("allowed %d events after 300ms at 10 events per second, expected 3", taken)
+	}
+	// The bucket never holds more than a burst.
+	refill(time.Hour)
+	taken = 0
+	for i := 0; i < 100; i++ {
+		if sampler.allowed() {
+			taken++
+		}
+	}
+	if taken != 5 {
+		t.Fatalf("allowed %d events after a long pause, expected a burst of 5", taken)
+	}
+	// The default burst is the rate rounded up.
+	if burst := newLogSampler(&LoadModelOptions{LogRateLimit: 2.5}).limiter.burst; burst != 3 {
+		t.Fatalf("the default burst is %v, expected 3", burst)
+	}
+}
@@ -0,0 +1,150 @@
+package modelfox
+
+// #include "helpers.h"
+import "C"
+
+import (
+	"log"
+	"sync"
+)
+
+// This is the largest buffer, in elements, that is kept for reuse. Larger buffers are left for the garbage collector, so one huge batch does not pin its memory forever.
+const maxPooledPredictBufferLen = 1 << 20
+
+// A predictScratch holds the buffers used to marshal a batch of inputs for libmodelfox. Scratch buffers are pooled, so steady state predictions do not allocate them.
+type predictScratch struct {
+	kinds   []uint8
+	numbers []float64
+	offsets []C.size_t
+	data    []byte
+	rowLens []C.size_t
+	// This holds C pointers only, so it may be passed to C.
+	cInputs []*C.modelfox_predict_input
+}
+
+var predictScratchPool = sync.Pool{
+	New: func() interface{} {
+		return new(predictScratch)
+	},
+}
+
+func getPredictScratch() *predictScratch {
+	return predictScratchPool.Get().(*predictScratch)
+}
+
+func (s *predictScratch) release() {
+	if cap(s.data) > maxPooledPredictBufferLen || cap(s.offsets) > maxPooledPredictBufferLen {
+		return
+	}
+	s.data = s.data[:0]
+	predictScratchPool.Put(s)
+}
+
+// Resize the scratch buffers to hold `numValues` kinds and numbers and `numOffsets` offsets. The contents of the buffers are not cleared.
+func (s *predictScratch) reserve(numValues int, numOffsets int) {
+	if cap(s.kinds) < numValues {
+		s.kinds = make([]uint8, numValues)
+		s.numbers = make([]float64, numValues)
+	}
+	if cap(s.offsets) < numOffsets {
+		s.offsets = make([]C.size_t, numOffsets)
+	}
+	s.kinds = s.kinds[:numValues]
+	s.numbers = s.numbers[:numValues]
+	s.offsets = s.offsets[:numOffsets]
+	s.data = s.data[:0]
+}
+
+func (s *predictScratch) reserveRowLens(numRows int) {
+	if cap(s.rowLens) < numRows {
+		s.rowLens = make([]C.size_t, numRows)
+	}
+	s.rowLens = s.rowLens[:numRows]
+}
+
+func (s *predictScratch) reserveInputs(numRows int) {
+	if cap(s.cInputs) < numRows {
+		s.cInputs = make([]*C.modelfox_predict_input, numRows)
+	}
+	s.cInputs = s.cInputs[:numRows]
+}
+
+// A PredictSession holds the slices that a sequence of predictions writes its outputs to, so that serving a request does not allocate them. Sessions are pooled by the model: get one with `model.NewPredictSession`, use it for one request, and return it with `session.Release`. The outputs returned by a session are only valid until the session is reset or released. A session must not be used by more than one goroutine at a time.
+//
+// Only the slices are reused. Each output stored in the `[]PredictOutput` slice is still boxed into the `PredictOutput` interface, which allocates, and multiclass probabilities and feature contributions are allocated for each output. `session.PredictInto` writes only values and class indices, so it allocates no outputs at all. libmodelfox also allocates its own inputs and outputs for every prediction and does not expose a way to reuse them.
+type PredictSession struct {
+	model        *Model
+	outputs      []PredictOutput
+	values       []float32
+	classIndices []int
+}
+
+// Get a prediction session from the model's pool.
+func (m *Model) NewPredictSession() *PredictSession {
+	if session, ok := m.sessions.Get().(*PredictSession); ok {
+		return session
+	}
+	return &PredictSession{model: m}
+}
+
+// Make predictions with multiple inputs. The returned slice is owned by the session.
+func (s *PredictSession) Predict(input []PredictInput, options *PredictOptions) []PredictOutput {
+	s.reserveOutputs(len(input))
+	s.model.predictInputs(input, options, s.outputs)
+	return s.outputs
+}
+
+// Make predictions with a batch of inputs given column by column. The returned slice is owned by the session.
+func (s *PredictSession) PredictColumns(columns PredictColumns, options *PredictOptions) []PredictOutput {
+	s.reserveOutputs(predictColumnsLen(columns))
+	s.model.predictColumns(columns, options, s.outputs)
+	return s.outputs
+}
+
+// Make predictions with inputs whose values were set by column index. The returned slice is owned by the session.
+func (s *PredictSession) PredictIndexed(input []*IndexedPredictInput, options *PredictOptions) []PredictOutput {
+	s.reserveOutputs(len(input))
+	s.model.predictIndexed(input, options, s.outputs)
+	return s.outputs
+}
+
+// Make predictions like `model.PredictInto`, writing the values and class indices to slices owned by the session.
+func (s *PredictSession) PredictInto(input []PredictInput, options *PredictOptions) ([]float32, []int) {
+	if cap(s.values) < len(input) {
+		s.values = make([]float32, len(input))
+		s.classIndices = make([]int, len(input))
+	}
+	s.values = s.values[:len(input)]
+	s.classIndices = s.classIndices[:len(input)]
+	s.model.PredictInto(input, options, s.values, s.classIndices)
+	return s.values, s.classIndices
+}
+
+func (s *PredictSession) reserveOutputs(numRows int) {
+	if s.model.modelPtr == nil {
+		log.Fatal("modelfox error: the prediction session's model has been destroyed")
+	}
+	if cap(s.outputs) < numRows {
+		s.outputs = make([]PredictOutput, numRows)
+	}
+	s.outputs = s.outputs[:numRows]
+}
+
+// Clear the outputs of the previous predictions so the session can be reused.
+func (s *PredictSession) Reset() {
+	for i := range s.outputs {
+		s.outputs[i] = nil
+	}
+	s.outputs = s.outputs[:0]
+	s.values = s.values[:0]
+	s.classIndices = s.classIndices[:0]
+}
+
+// Reset the session and return it to the model's pool. The session must not be used afterward.
+func (s *PredictSession) Release() {
+	s.Reset()
+	if cap(s.outputs) > maxPooledPredictBufferLen || cap(s.values) > maxPooledPredictBufferLen {
+		return
+	}
+	s.model.sessions.Put(s)
+}
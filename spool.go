@@ -0,0 +1,449 @@
+package modelfox
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"log"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+const (
+	defaultLogSpoolMaxBytes = 1 << 30
+	maxSpoolSegmentBytes    = 16 << 20
+	spoolSyncInterval       = 200 * time.Millisecond
+	spoolMinRetryInterval   = time.Second
+	spoolMaxRetryInterval   = time.Minute
+	spoolSegmentExtension   = ".spool"
+	spoolCursorFileName     = "cursor"
+	// Each record starts with the length of its body, the CRC-32 of its body, and the number of events in it.
+	spoolRecordHeaderLen = 12
+)
+
+// An eventSpool keeps batches of events that could not be sent to the app in files on disk, and sends them again in order from a background goroutine once the app is reachable. Batches are appended to segment files, so writing a batch costs a single write, and the files are synced at most every `spoolSyncInterval` instead of once per batch. Delivery is at least once: a batch that was sent just before the program exited may be sent again after it restarts. A batch the app rejects is dropped instead of being retried, because it would be rejected again.
+type eventSpool struct {
+	dir      string
+	maxBytes int64
+	// Segments are only dropped whole, so they are kept small relative to `maxBytes`.
+	segmentBytes int64
+	post         func([]byte) error
+	handleError  func(error)
+	dropped      *uint64
+	mutex        sync.Mutex
+	// These are the segments that have not been fully sent, oldest first. The last one is the segment being written to.
+	segments   []spoolSegment
+	writer     *os.File
+	reader     *os.File
+	readerSeq  uint64
+	readOffset int64
+	totalBytes int64
+	dirty      bool
+	// This is the record being sent by the background goroutine, if any. If its segment is dropped while it is being sent, its events are counted as dropped only if sending it fails, so they are never counted twice.
+	inFlight        *spoolRecord
+	inFlightDropped bool
+	wake            chan struct{}
+	stop            chan struct{}
+	done            chan struct{}
+}
+
+type spoolSegment struct {
+	seq  uint64
+	size int64
+}
+
+// A spoolRecord is a batch of events read from the spool.
+type spoolRecord struct {
+	body      []byte
+	numEvents int
+	seq       uint64
+	// This is the offset of the record after this one in its segment.
+	next int64
+}
+
+func openEventSpool(options *LoadModelOptions, post func([]byte) error, handleError func(error), dropped *uint64) (*eventSpool, error) {
+	s := eventSpool{
+		dir:         options.LogSpoolDir,
+		maxBytes:    defaultLogSpoolMaxBytes,
+		post:        post,
+		handleError: handleError,
+		dropped:     dropped,
+		wake:        make(chan struct{}, 1),
+		stop:        make(chan struct{}),
+		done:        make(chan struct{}),
+	}
+	if options.LogSpoolMaxBytes > 0 {
+		s.maxBytes = options.LogSpoolMaxBytes
+	}
+	s.segmentBytes = s.maxBytes / 8
+	if s.segmentBytes > maxSpoolSegmentBytes {
+		s.segmentBytes = maxSpoolSegmentBytes
+	}
+	if err := os.MkdirAll(s.dir, 0o755); err != nil {
+		return nil, err
+	}
+	entries, err := os.ReadDir(s.dir)
+	if err != nil {
+		return nil, err
+	}
+	for _, entry := range entries {
+		name := entry.Name()
+		if !strings.HasSuffix(name, spoolSegmentExtension) {
+			continue
+		}
+		seq, err := strconv.ParseUint(strings.TrimSuffix(name, spoolSegmentExtension), 10, 64)
+		if err != nil {
+			continue
+		}
+		info, err := entry.Info()
+		if err != nil {
+			return nil, err
+		}
+		s.segments = append(s.segments, spoolSegment{seq: seq, size: info.Size()})
+		s.totalBytes += info.Size()
+	}
+	sort.Slice(s.segments, func(i, j int) bool {
+		return s.segments[i].seq < s.segments[j].seq
+	})
+	// Resume from the cursor if it points into the oldest segment.
+	if cursor, err := os.ReadFile(filepath.Join(s.dir, spoolCursorFileName)); err == nil && len(s.segments) > 0 {
+		var seq uint64
+		var offset int64
+		if _, err := fmt.Sscanf(string(cursor), "%d %d", &seq, &offset); err == nil && seq == s.segments[0].seq && offset <= s.segments[0].size {
+			s.readOffset = offset
+		}
+	}
+	// Always write to a new segment, so that a batch that was only partly written before the program exited is never followed by new batches.
+	nextSeq := uint64(0)
+	if len(s.segments) > 0 {
+		nextSeq = s.segments[len(s.segments)-1].seq + 1
+	}
+	if err := s.openSegment(nextSeq); err != nil {
+		return nil, err
+	}
+	go s.run()
+	return &s, nil
+}
+
+func (s *eventSpool) segmentPath(seq uint64) string {
+	return filepath.Join(s.dir, fmt.Sprintf("%020d%s", seq, spoolSegmentExtension))
+}
+
+func (s *eventSpool) openSegment(seq uint64) error {
+	writer, err := os.OpenFile(s.segmentPath(seq), os.O_CREATE|os.O_EXCL|os.O_WRONLY|os.O_APPEND, 0o644)
+	if err != nil {
+		return err
+	}
+	s.writer = writer
+	s.segments = append(s.segments, spoolSegment{seq: seq})
+	return nil
+}
+
+// Send the JSON encoded batch of `numEvents` events in `body` to the app. If the app cannot be reached, or if earlier batches are still waiting in the spool, the batch is added to the spool instead, and an error is returned only if that fails. If the app rejects the batch, it is not added to the spool, because it would be rejected again, and the error is returned.
+func (s *eventSpool) send(body []byte, numEvents int) error {
+	if !s.pending() {
+		err := s.post(body)
+		if err == nil || !isRetryableLogError(err) {
+			return err
+		}
+	}
+	return s.append(body, numEvents)
+}
+
+func (s *eventSpool) pending() bool {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	return s.totalBytes > s.readOffset
+}
+
+func (s *eventSpool) append(body []byte, numEvents int) error {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	if s.writer == nil {
+		return errors.New("modelfox error: the log spool is closed")
+	}
+	active := &s.segments[len(s.segments)-1]
+	if active.size >= s.segmentBytes {
+		if err := s.writer.Sync(); err != nil {
+			return err
+		}
+		if err := s.writer.Close(); err != nil {
+			return err
+		}
+		if err := s.openSegment(active.seq + 1); err != nil {
+			s.writer = nil
+			return err
+		}
+		active = &s.segments[len(s.segments)-1]
+	}
+	record := make([]byte, spoolRecordHeaderLen+len(body))
+	binary.LittleEndian.PutUint32(record[0:4], uint32(len(body)))
+	binary.LittleEndian.PutUint32(record[4:8], crc32.ChecksumIEEE(body))
+	binary.LittleEndian.PutUint32(record[8:12], uint32(numEvents))
+	copy(record[spoolRecordHeaderLen:], body)
+	if _, err := s.writer.Write(record); err != nil {
+		return err
+	}
+	active.size += int64(len(record))
+	s.totalBytes += int64(len(record))
+	s.dirty = true
+	// Drop the oldest segments once the spool is over its limit.
+	for s.totalBytes > s.maxBytes && len(s.segments) > 1 {
+		s.dropOldestSegment(true)
+	}
+	select {
+	case s.wake <- struct{}{}:
+	default:
+	}
+	return nil
+}
+
+func (s *eventSpool) dropOldestSegment(countDropped bool) {
+	oldest := s.segments[0]
+	if countDropped {
+		atomic.AddUint64(s.dropped, s.countEvents(oldest))
+		if s.inFlight != nil && s.inFlight.seq == oldest.seq {
+			s.inFlightDropped = true
+		}
+	}
+	if s.reader != nil && s.readerSeq == oldest.seq {
+		s.reader.Close()
+		s.reader = nil
+	}
+	os.Remove(s.segmentPath(oldest.seq))
+	s.segments = s.segments[1:]
+	s.totalBytes -= oldest.size
+	s.readOffset = 0
+}
+
+// Count the events in the unsent records of a segment, other than the record being sent.
+func (s *eventSpool) countEvents(segment spoolSegment) uint64 {
+	file, err := os.Open(s.segmentPath(segment.seq))
+	if err != nil {
+		return 0
+	}
+	defer file.Close()
+	var count uint64
+	header := make([]byte, spoolRecordHeaderLen)
+	offset := int64(0)
+	if s.inFlight != nil && s.inFlight.seq == segment.seq {
+		offset = s.inFlight.next
+	} else if segment.seq == s.segments[0].seq {
+		offset = s.readOffset
+	}
+	for {
+		if _, err := file.ReadAt(header, offset); err != nil {
+			return count
+		}
+		count += uint64(binary.LittleEndian.Uint32(header[8:12]))
+		offset += spoolRecordHeaderLen + int64(binary.LittleEndian.Uint32(header[0:4]))
+	}
+}
+
+// Read the oldest unsent record. Errors are reported after the lock is released, because the error handler may call back into the model, which takes the lock.
+func (s *eventSpool) peek() (spoolRecord, bool) {
+	record, ok, errs := s.readOldestRecord()
+	for _, err := range errs {
+		s.handleError(err)
+	}
+	return record, ok
+}
+
+func (s *eventSpool) readOldestRecord() (spoolRecord, bool, []error) {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	var errs []error
+	for len(s.segments) > 0 {
+		oldest := s.segments[0]
+		isActive := len(s.segments) == 1
+		if s.readOffset+spoolRecordHeaderLen <= oldest.size {
+			body, numEvents, err := s.readRecord(oldest.seq, s.readOffset)
+			if err == nil {
+				record := spoolRecord{
+					body:      body,
+					numEvents: numEvents,
+					seq:       oldest.seq,
+					next:      s.readOffset + spoolRecordHeaderLen + int64(len(body)),
+				}
+				s.inFlight = &record
+				s.inFlightDropped = false
+				return record, true, errs
+			}
+			// A record can only be incomplete or corrupt if the program exited while writing it, which makes it the last record in an old segment.
+			errs = append(errs, err)
+		}
+		if isActive {
+			return spoolRecord{}, false, errs
+		}
+		s.dropOldestSegment(false)
+	}
+	return spoolRecord{}, false, errs
+}
+
+func (s *eventSpool) readRecord(seq uint64, offset int64) ([]byte, int, error) {
+	if s.reader == nil || s.readerSeq != seq {
+		if s.reader != nil {
+			s.reader.Close()
+		}
+		reader, err := os.Open(s.segmentPath(seq))
+		if err != nil {
+			s.reader = nil
+			return nil, 0, err
+		}
+		s.reader = reader
+		s.readerSeq = seq
+	}
+	header := make([]byte, spoolRecordHeaderLen)
+	if _, err := s.reader.ReadAt(header, offset); err != nil {
+		return nil, 0, err
+	}
+	body := make([]byte, binary.LittleEndian.Uint32(header[0:4]))
+	if _, err := s.reader.ReadAt(body, offset+spoolRecordHeaderLen); err != nil {
+		if err == io.EOF {
+			err = io.ErrUnexpectedEOF
+		}
+		return nil, 0, err
+	}
+	if crc32.ChecksumIEEE(body) != binary.LittleEndian.Uint32(header[4:8]) {
+		return nil, 0, errors.New("modelfox error: corrupt record in log spool segment " + s.segmentPath(seq))
+	}
+	return body, int(binary.LittleEndian.Uint32(header[8:12])), nil
+}
+
+// Mark the record read by `peek` as sent.
+func (s *eventSpool) advance(record spoolRecord) {
+	if err := s.moveCursor(record); err != nil {
+		s.handleError(err)
+	}
+}
+
+func (s *eventSpool) moveCursor(record spoolRecord) error {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	s.inFlight = nil
+	if len(s.segments) == 0 || s.segments[0].seq != record.seq {
+		// The segment was dropped while the record was being sent.
+		return nil
+	}
+	s.readOffset = record.next
+	if len(s.segments) > 1 && s.readOffset >= s.segments[0].size {
+		s.dropOldestSegment(false)
+	}
+	return s.writeCursor()
+}
+
+// Give up on sending the record read by `peek` for now, so that it is read again on the next retry. If its segment was dropped in the meantime, it will not be read again, so its events are counted as dropped.
+func (s *eventSpool) release(record spoolRecord) {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	if s.inFlightDropped {
+		atomic.AddUint64(s.dropped, uint64(record.numEvents))
+	}
+	s.inFlight = nil
+	s.inFlightDropped = false
+}
+
+func (s *eventSpool) writeCursor() error {
+	if len(s.segments) == 0 {
+		return nil
+	}
+	cursor := fmt.Sprintf("%d %d", s.segments[0].seq, s.readOffset)
+	return os.WriteFile(filepath.Join(s.dir, spoolCursorFileName), []byte(cursor), 0o644)
+}
+
+func (s *eventSpool) sync() {
+	if err := s.syncWriter(); err != nil {
+		s.handleError(err)
+	}
+}
+
+func (s *eventSpool) syncWriter() error {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	if !s.dirty || s.writer == nil {
+		return nil
+	}
+	s.dirty = false
+	return s.writer.Sync()
+}
+
+func (s *eventSpool) run() {
+	defer close(s.done)
+	ticker := time.NewTicker(spoolSyncInterval)
+	defer ticker.Stop()
+	retryInterval := spoolMinRetryInterval
+	var retry <-chan time.Time
+	for {
+		if retry == nil {
+			if record, ok := s.peek(); ok {
+				if err := s.post(record.body); err != nil && isRetryableLogError(err) {
+					s.release(record)
+					s.handleError(err)
+					retry = time.After(retryInterval)
+					retryInterval *= 2
+					if retryInterval > spoolMaxRetryInterval {
+						retryInterval = spoolMaxRetryInterval
+					}
+				} else {
+					if err != nil {
+						// The app rejected the record and would reject it on every retry, so it is dropped to let the records after it be sent.
+						s.handleError(err)
+						atomic.AddUint64(s.dropped, uint64(record.numEvents))
+					}
+					retryInterval = spoolMinRetryInterval
+					s.advance(record)
+					select {
+					case <-s.stop:
+						s.sync()
+						return
+					default:
+						continue
+					}
+				}
+			}
+		}
+		select {
+		case <-s.wake:
+		case <-retry:
+			retry = nil
+		case <-ticker.C:
+			s.sync()
+		case <-s.stop:
+			s.sync()
+			return
+		}
+	}
+}
+
+// Stop sending batches and close the spool's files. Batches that have not been sent stay on disk and are sent the next time a model is loaded with the same directory.
+func (s *eventSpool) close() {
+	close(s.stop)
+	<-s.done
+	if err := s.closeFiles(); err != nil {
+		s.handleError(err)
+	}
+}
+
+func (s *eventSpool) closeFiles() error {
+	s.mutex.Lock()
+	defer s.mutex.Unlock()
+	if s.writer != nil {
+		if err := s.writer.Close(); err != nil {
+			log.Println("modelfox: failed to close the log spool:", err)
+		}
+		s.writer = nil
+	}
+	if s.reader != nil {
+		s.reader.Close()
+		s.reader = nil
+	}
+	return s.writeCursor()
+}
@@ -0,0 +1,260 @@
+package modelfox
+
+import (
+	"net/http"
+	"os"
+	"path/filepath"
+	"strconv"
+	"sync"
+	"testing"
+	"time"
+)
+
+// An errorRecorder is a `LogErrorHandler` that keeps the errors it is called with.
+type errorRecorder struct {
+	mutex sync.Mutex
+	errs  []error
+}
+
+func (r *errorRecorder) handle(err error) {
+	r.mutex.Lock()
+	defer r.mutex.Unlock()
+	r.errs = append(r.errs, err)
+}
+
+func (r *errorRecorder) len() int {
+	r.mutex.Lock()
+	defer r.mutex.Unlock()
+	return len(r.errs)
+}
+
+// Wait until `done` returns true. The spool retries sending after at least a second, so this waits for a while before giving up.
+func waitFor(t *testing.T, description string, done func() bool) {
+	t.Helper()
+	deadline := time.Now().Add(10 * time.Second)
+	for !done() {
+		if time.Now().After(deadline) {
+			t.Fatal("timed out waiting for " + description)
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+}
+
+func logTrueValues(t *testing.T, model *Model, identifiers ...string) {
+	t.Helper()
+	for _, identifier := range identifiers {
+		if err := model.LogTrueValue(LogTrueValueArgs{Identifier: identifier, TrueValue: "Positive"}); err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func receivedIdentifiers(app *testApp) []string {
+	var identifiers []string
+	for _, event := range app.receivedEvents() {
+		identifiers = append(identifiers, event["identifier"].(string))
+	}
+	return identifiers
+}
+
+func checkIdentifiers(t *testing.T, app *testApp, expected ...string) {
+	t.Helper()
+	identifiers := receivedIdentifiers(app)
+	if len(identifiers) != len(expected) {
+		t.Fatalf("the app received %v, expected %v", identifiers, expected)
+	}
+	for i := range expected {
+		if identifiers[i] != expected[i] {
+			t.Fatalf("the app received %v, expected %v", identifiers, expected)
+		}
+	}
+}
+
+func sequentialIdentifiers(start int, end int) []string {
+	var identifiers []string
+	for i := start; i < end; i++ {
+		identifiers = append(identifiers, strconv.Itoa(i))
+	}
+	return identifiers
+}
+
+func spoolSegmentsSize(t *testing.T, dir string) int64 {
+	t.Helper()
+	paths, err := filepath.Glob(filepath.Join(dir, "*"+spoolSegmentExtension))
+	if err != nil {
+		t.Fatal(err)
+	}
+	var size int64
+	for _, path := range paths {
+		info, err := os.Stat(path)
+		if err != nil {
+			t.Fatal(err)
+		}
+		size += info.Size()
+	}
+	return size
+}
+
+func TestSpoolReplaysInOrder(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	app.setStatus(http.StatusServiceUnavailable)
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL:     app.URL,
+		LogSpoolDir:     t.TempDir(),
+		LogErrorHandler: func(error) {},
+	})
+	defer model.stopLogging()
+	identifiers := sequentialIdentifiers(0, 50)
+	logTrueValues(t, model, identifiers...)
+	if len(app.receivedEvents()) != 0 {
+		t.Fatal("the app accepted events while it was unavailable")
+	}
+	app.setStatus(http.StatusOK)
+	waitFor(t, "the spool to be sent", func() bool {
+		return len(app.receivedEvents()) == len(identifiers)
+	})
+	checkIdentifiers(t, app, identifiers...)
+	if model.DroppedLogEvents() != 0 {
+		t.Fatalf("dropped %d events", model.DroppedLogEvents())
+	}
+}
+
+func TestSpoolKeepsEventsAcrossRestarts(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	app.setStatus(http.StatusServiceUnavailable)
+	options := LoadModelOptions{
+		ModelFoxURL:     app.URL,
+		LogSpoolDir:     t.TempDir(),
+		LogErrorHandler: func(error) {},
+	}
+	model := newLoggingTestModel(t, options)
+	identifiers := sequentialIdentifiers(0, 10)
+	logTrueValues(t, model, identifiers...)
+	model.stopLogging()
+	app.setStatus(http.StatusOK)
+	model = newLoggingTestModel(t, options)
+	waitFor(t, "the spool to be sent", func() bool {
+		return len(app.receivedEvents()) == len(identifiers)
+	})
+	model.stopLogging()
+	// The cursor was saved, so the events are not sent again.
+	model = newLoggingTestModel(t, options)
+	time.Sleep(200 * time.Millisecond)
+	model.stopLogging()
+	checkIdentifiers(t, app, identifiers...)
+}
+
+func TestSpoolDropsRejectedRecords(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	app.setStatus(http.StatusServiceUnavailable)
+	errs := errorRecorder{}
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL:     app.URL,
+		LogSpoolDir:     t.TempDir(),
+		LogErrorHandler: errs.handle,
+	})
+	defer model.stopLogging()
+	logTrueValues(t, model, "0", "rejected", "1")
+	app.setStatus(http.StatusOK)
+	waitFor(t, "the records after the rejected one to be sent", func() bool {
+		return len(app.receivedEvents()) == 2
+	})
+	checkIdentifiers(t, app, "0", "1")
+	if model.DroppedLogEvents() != 1 || errs.len() == 0 {
+		t.Fatalf("dropped %d events and reported %d errors, expected the rejected event to be dropped and reported", model.DroppedLogEvents(), errs.len())
+	}
+	// Once the spool is empty, a rejected batch is returned as an error instead of being spooled, so later events are sent right away.
+	if err := model.LogTrueValue(LogTrueValueArgs{Identifier: "rejected", TrueValue: "Positive"}); err == nil {
+		t.Fatal("expected the rejected event to fail")
+	}
+	logTrueValues(t, model, "2")
+	checkIdentifiers(t, app, "0", "1", "2")
+}
+
+func TestSpoolSkipsIncompleteRecords(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	app.setStatus(http.StatusServiceUnavailable)
+	dir := t.TempDir()
+	options := LoadModelOptions{
+		ModelFoxURL:     app.URL,
+		LogSpoolDir:     dir,
+		LogErrorHandler: func(error) {},
+	}
+	model := newLoggingTestModel(t, options)
+	logTrueValues(t, model, "0", "1", "2")
+	model.stopLogging()
+	// Cut off the end of the last record, as if the program exited while writing it.
+	path := (&eventSpool{dir: dir}).segmentPath(0)
+	info, err := os.Stat(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := os.Truncate(path, info.Size()-5); err != nil {
+		t.Fatal(err)
+	}
+	app.setStatus(http.StatusOK)
+	// The error handler flushes the log queue, which must not deadlock with the spool reporting the incomplete record.
+	ready := make(chan struct{})
+	flushed := make(chan error, 1)
+	var once sync.Once
+	options.LogErrorHandler = func(error) {
+		once.Do(func() {
+			<-ready
+			model.EnqueueLogTrueValue(LogTrueValueArgs{Identifier: "3", TrueValue: "Positive"})
+			flushed <- model.FlushLogQueue()
+		})
+	}
+	model = newLoggingTestModel(t, options)
+	close(ready)
+	select {
+	case err := <-flushed:
+		if err != nil {
+			t.Fatal(err)
+		}
+	case <-time.After(10 * time.Second):
+		t.Fatal("flushing the log queue from the error handler deadlocked")
+	}
+	model.stopLogging()
+	checkIdentifiers(t, app, "0", "1", "3")
+}
+
+func TestSpoolEvictsOldestSegments(t *testing.T) {
+	app := newTestApp()
+	defer app.Close()
+	app.setStatus(http.StatusServiceUnavailable)
+	dir := t.TempDir()
+	const maxBytes = 4096
+	model := newLoggingTestModel(t, LoadModelOptions{
+		ModelFoxURL:      app.URL,
+		LogSpoolDir:      dir,
+		LogSpoolMaxBytes: maxBytes,
+		LogErrorHandler:  func(error) {},
+	})
+	defer model.stopLogging()
+	identifiers := sequentialIdentifiers(0, 200)
+	logTrueValues(t, model, identifiers...)
+	if size := spoolSegmentsSize(t, dir); size > maxBytes {
+		t.Fatalf("the spool holds %d bytes, more than its limit of %d", size, maxBytes)
+	}
+	// A record that was being sent when its segment was dropped is delivered if the app becomes available before the send finishes, so wait for the send to fail first.
+	waitFor(t, "the spool to stop sending", func() bool {
+		model.spool.mutex.Lock()
+		defer model.spool.mutex.Unlock()
+		return model.spool.inFlight == nil
+	})
+	app.setStatus(http.StatusOK)
+	// The replayer may have been sending the oldest record when its segment was dropped, so wait until every event was either received or counted as dropped.
+	waitFor(t, "the spool to be sent", func() bool {
+		return len(app.receivedEvents())+int(model.DroppedLogEvents()) == len(identifiers)
+	})
+	dropped := int(model.DroppedLogEvents())
+	if dropped == 0 {
+		t.Fatal("expected the oldest events to be dropped")
+	}
+	// The newest events are kept, in order, and no event is both received and counted as dropped.
+	checkIdentifiers(t, app, identifiers[dropped:]...)
+}
@@ -10,46 +10,117 @@ package modelfox
 // #cgo darwin,arm64 LDFLAGS: -L${SRCDIR}/libmodelfox/aarch64-apple-darwin -lmodelfox
 // #cgo windows,amd64 CFLAGS: -I${SRCDIR}/libmodelfox/x86_64-pc-windows-gnu
 // #cgo windows,amd64 LDFLAGS: -L${SRCDIR}/libmodelfox/x86_64-pc-windows-gnu -lmodelfox -luserenv -lws2_32
-// #include "modelfox.h"
+// #include "helpers.h"
 // #include <stdlib.h>
 import "C"
 
 import (
 	"bytes"
-	"encoding/json"
+	"compress/gzip"
+	"context"
 	"errors"
 	"io/ioutil"
 	"log"
+	"math"
 	"net/http"
 	"strconv"
+	"sync"
+	"sync/atomic"
 	"time"
 	"unsafe"
 )
 
-// Use this struct to load a model, make predictions, and log events to the app.
+// Use this struct to load a model, make predictions, and log events to the app. A model is safe for concurrent use by multiple goroutines, so you can load it once and share it across all of your request handlers. libmodelfox never modifies a loaded model, so concurrent predictions do not take any locks. The only exception is `Destroy`, which must not be called while other calls are in progress.
 type Model struct {
 	modelPtr *C.modelfox_model
-	options  *LoadModelOptions
-	logQueue []event
+	// The id and task never change for the life of the model, so they are read once when it is loaded instead of on every call.
+	id      string
+	task    C.modelfox_task
+	options *LoadModelOptions
+	logger  *eventLogger
+	spool   *eventSpool
+	// Events are sent with this client, and every request is cancelled by `cancelLogging` when the model is destroyed.
+	httpClient    *http.Client
+	logContext    context.Context
+	cancelLogging context.CancelFunc
+	sampler       *logSampler
+	classes       *classTable
+	names         *nameTable
+	// This holds the libmodelfox predict options handles shared by every prediction with the same options.
+	predictOptions predictOptionsCache
+	sessions       sync.Pool
 }
 
 // These are the options passed when loading a model.
 type LoadModelOptions struct {
 	// If you are running the app locally or on your own server, use this field to provide the url to it. If not specified, the default value is https://app.modelfox.dev.
 	ModelFoxURL string
+	// If you set this field to `true`, `model.LogPrediction` and `model.LogTrueValue` will add events to the log queue and return immediately, and the queued events will be sent to the app in batches in the background. This keeps the latency of your predictions independent of the app. Remember to call `model.Destroy` to send any events still in the queue.
+	BackgroundLogging bool
+	// This is the number of events the log queue can hold. If not specified, the default value is 10000.
+	LogQueueSize int
+	// Queued events are sent in the background as soon as this many have been queued. If not specified, the default value is 100.
+	LogBatchSize int
+	// If background logging is enabled, queued events are sent at least this often, even if there are fewer than `LogBatchSize` of them. If not specified, the default value is one second.
+	LogFlushInterval time.Duration
+	// This determines what happens when an event is logged while the log queue is full. If not specified, the event is dropped.
+	LogQueueFullPolicy LogQueueFullPolicy
+	// This function is called with the error when sending queued events to the app in the background fails. If the app could not be reached or responded with a server error, the events are kept and sent again with the next batch. If the app rejected the events, or an event could not be encoded, those events are dropped. The function is called from the goroutine that sends events, so it must not call `model.FlushLogQueue` or `model.Destroy`. If not specified, the error is written with the standard logger.
+	LogErrorHandler func(error)
+	// If you set this field to `true`, events sent to the app will be compressed with gzip. Only enable this if your app, or a proxy in front of it, accepts gzip encoded request bodies.
+	CompressLogs bool
+	// If you set this field to the path of a directory, events that cannot be sent to the app are written to files in this directory instead of being kept in memory, and are sent again in the background, in order, once the app is reachable. Events that have not been sent when your program exits stay in the directory and are sent after a model is next loaded with the same directory. Use a separate directory for each loaded model.
+	LogSpoolDir string
+	// This is the most disk space, in bytes, that the files in `LogSpoolDir` will use. When the limit is reached, the oldest events are dropped. If not specified, the default value is one gigabyte.
+	LogSpoolMaxBytes int64
+	// If you set this field to a number between 0 and 1, only this fraction of events are logged. Events are sampled by a hash of their identifier, so a true value is logged if and only if the prediction with the same identifier was. If not specified, every event is logged.
+	LogSampleRate float64
+	// If you set this field, at most this many events per second on average are logged, and the rest are dropped. If not specified, the number of events logged is not limited.
+	LogRateLimit float64
+	// If `LogRateLimit` is set, this many events can be logged at once before the rate limit applies. If not specified, the default value is `LogRateLimit` rounded up.
+	LogRateBurst int
+	// This is the longest that a request sending events to the app may take, after which it fails and its events are kept and sent again. `model.Destroy` also waits at most this long to send the events still in the log queue, so an app that does not respond cannot block your program. If not specified, the default value is ten seconds.
+	LogRequestTimeout time.Duration
 }
 
 // These are the options passed to `Predict`.
 type PredictOptions struct {
-	// If your model is a binary classifier, use this field to make predictions using a threshold chosen on the tuning page of the app. The default value is `0.5`.
+	// If your model is a binary classifier, use this field to make predictions using a threshold chosen on the tuning page of the app. If not set, the default value `0.5` is used, so setting only the other fields does not change the threshold.
 	Threshold float32 `json:"threshold"`
 	// Computing feature contributions is disabled by default. If you set this field to `true`, you will be able to access the feature contributions with the `feature_contributions` field of the predict output.
 	ComputeFeatureContributions bool `json:"computeFeatureContributions"`
+	// Large batches are predicted on a single thread by default. If you set this field to a number greater than one, the batch will be split into chunks that are predicted on up to this many threads at once. The outputs are always in the same order as the inputs. `runtime.NumCPU()` is a good choice for large offline batches.
+	NumThreads int `json:"-"`
+	// If you set this field to a number greater than zero along with `ComputeFeatureContributions`, only this many feature contribution entries are returned: the ones with the largest absolute feature contribution values, in descending order of absolute value. The other entries are never converted to Go values, which makes feature contributions much cheaper for models with many features.
+	FeatureContributionsTopK int `json:"-"`
 }
 
 // This is the input type of `Predict`. A predict input is a map from strings to strings or floats. The keys should match the columns in the CSV file you trained your model with.
 type PredictInput map[string]interface{}
 
+// This is the input type of `PredictColumns`. It holds a batch of inputs column by column instead of row by row. Each slice holds one value per row, and every column must have the same number of rows. The keys should match the columns in the CSV file you trained your model with.
+type PredictColumns struct {
+	// This maps column names to the numeric values of that column.
+	NumberColumns map[string][]float64
+	// This maps column names to the string values of that column.
+	StringColumns map[string][]string
+}
+
+// A ColumnSchema holds a list of column names that are resolved once, so that predict inputs can be filled by column index instead of by column name. Create one with `NewColumnSchema` when you load your model and reuse it for every prediction.
+type ColumnSchema struct {
+	columnNames   []string
+	columnIndices map[string]int
+	cColumnNames  **C.char
+}
+
+// This is a predict input whose values are set by column index in a `ColumnSchema`. Create one with `schema.NewPredictInput` and pass it to `model.PredictIndexed`.
+type IndexedPredictInput struct {
+	schema  *ColumnSchema
+	kinds   []uint8
+	numbers []float64
+	strings []string
+}
+
 // TaskType is the type of the task corresponding to the model task, one of RegressionTaskType, BinaryClassificationTaskType, and MulticlassClassificationTaskType.
 type TaskType int
 
@@ -80,6 +151,8 @@ type RegressionPredictOutput struct {
 type BinaryClassificationPredictOutput struct {
 	// This is the name of the predicted class.
 	ClassName string `json:"className"`
+	// This is the index of the predicted class in `model.Classes`.
+	ClassIndex int `json:"-"`
 	// This is the probability the model assigned to the predicted class.
 	Probability float32 `json:"probability"`
 	// If computing feature contributions was enabled in the predict options, this value will explain the model's output, showing how much each feature contributed to the output.
@@ -89,7 +162,9 @@ type BinaryClassificationPredictOutput struct {
 // `Predict` outputs `MulticlassClassificationPredictOutput` when the model's task is regression.
 type MulticlassClassificationPredictOutput struct {
 	// This is the name of the predicted class.
-	ClassName string `json:"className`
+	ClassName string `json:"className"`
+	// This is the index of the predicted class in `model.Classes`.
+	ClassIndex int `json:"-"`
 	// This is the probability the model assigned to the predicted class.
 	Probability float32 `json:"probability"`
 	// This value maps from class names to the probability the model assigned to each class.
@@ -108,6 +183,20 @@ type FeatureContributions struct {
 	Entries []FeatureContributionEntry
 }
 
+// This is the return type of `model.PredictFeatureContributionValues`. It holds the feature contributions of a batch of inputs as dense matrices of numbers, without an entry value for each feature.
+type FeatureContributionValues struct {
+	// This is the number of feature contributions for each input. It is one for regression and binary classification, and the number of classes for multiclass classification, in which case the classes are in the order of `model.Classes()`.
+	NumClasses int
+	// This is the number of features, which is the number of values in each feature contributions.
+	NumFeatures int
+	// These are the baseline values. The baseline value for input `i` and class `c` is at index `i * NumClasses + c`.
+	BaselineValues []float32
+	// These are the output values, indexed the same way as `BaselineValues`.
+	OutputValues []float32
+	// These are the feature contribution values. The value of feature `j` for input `i` and class `c` is at index `(i * NumClasses + c) * NumFeatures + j`, and features are in the same order as the entries of `FeatureContributions`.
+	Values []float32
+}
+
 // This identifies the type of a feature contribution.
 type FeatureContributionType int
 
@@ -131,12 +220,12 @@ type FeatureContributionEntry interface {
 	isFeatureContribution()
 }
 
-func (IdentityFeatureContribution) isFeatureContribution()      {}
-func (NormalizedFeatureContribution) isFeatureContribution()    {}
-func (OneHotEncodedFeatureContribution) isFeatureContribution() {}
-func (BagOfWordsFeatureContribution) isFeatureContribution()    {}
-func (BagOfWordsCosineSimilarityFeatureContribution) isFeatureContribution()    {}
-func (WordEmbeddingFeatureContribution) isFeatureContribution() {}
+func (IdentityFeatureContribution) isFeatureContribution()                   {}
+func (NormalizedFeatureContribution) isFeatureContribution()                 {}
+func (OneHotEncodedFeatureContribution) isFeatureContribution()              {}
+func (BagOfWordsFeatureContribution) isFeatureContribution()                 {}
+func (BagOfWordsCosineSimilarityFeatureContribution) isFeatureContribution() {}
+func (WordEmbeddingFeatureContribution) isFeatureContribution()              {}
 
 // This describes the contribution of a feature from an identity feature group
 type IdentityFeatureContribution struct {
@@ -230,7 +319,7 @@ type WordEmbeddingFeatureContribution struct {
 type LogPredictionArgs struct {
 	// This is a unique identifier for the prediction, which will associate it with a true value event and allow you to look it up in the app.
 	Identifier string
-	// This is the same `PredictInput` value that you passed to `model.Predict`.
+	// This is the same `PredictInput` value that you passed to `model.Predict`. If the event is queued, the map is copied, so you may modify it once the call returns. The values themselves are not copied, so values other than strings, numbers, and bools must not be modified until the event is sent.
 	Input PredictInput
 	// This is the same `PredictOptions` value that you passed to `model.Predict`.
 	Options PredictOptions
@@ -246,8 +335,6 @@ type LogTrueValueArgs struct {
 	TrueValue interface{}
 }
 
-type event map[string]interface{}
-
 // This is the version of libmodelfox that is in use.
 func Version() string {
 	var s C.modelfox_string_view
@@ -259,8 +346,7 @@ func Version() string {
 // Load a model from a `.modelfox` file at `path`.
 func LoadModelFromPath(path string, options *LoadModelOptions) (*Model, error) {
 	var cModel *C.modelfox_model
-	cPath := C.CString(path)
-	err := C.modelfox_model_from_path(cPath, &cModel)
+	err := C.modelfox_go_model_from_path(stringView(path), &cModel)
 	if err != nil {
 		var sv C.modelfox_string_view
 		defer C.modelfox_error_delete(err)
@@ -268,19 +354,16 @@ func LoadModelFromPath(path string, options *LoadModelOptions) (*Model, error) {
 		errs := C.GoStringN(sv.ptr, C.int(sv.len))
 		return nil, errors.New(errs)
 	}
-	queue := []event{}
-	model := Model{
-		cModel,
-		options,
-		queue,
-	}
-	return &model, nil
+	return newModel(cModel, options)
 }
 
-// Load a model from bytes instead of a file. You should use this only if you already have a `.modelfox` loaded into memory. Otherwise, use `model.LoadModelFromPath`, which is faster because it memory maps the file.
+// Load a model from bytes instead of a file. You should use this only if you already have a `.modelfox` loaded into memory. Otherwise, use `model.LoadModelFromPath`, which is faster because it memory maps the file. `data` is passed to libmodelfox without being copied and is only read while this function runs, so you can reuse or release it as soon as this function returns.
 func LoadModelFromBytes(data []byte, options *LoadModelOptions) (*Model, error) {
 	var cModel *C.modelfox_model
-	cBytes := C.CBytes(data)
+	var cBytes unsafe.Pointer
+	if len(data) > 0 {
+		cBytes = unsafe.Pointer(&data[0])
+	}
 	cLen := C.size_t(len(data))
 	err := C.modelfox_model_from_bytes(cBytes, cLen, &cModel)
 	if err != nil {
@@ -290,91 +373,369 @@ func LoadModelFromBytes(data []byte, options *LoadModelOptions) (*Model, error)
 		errs := C.GoStringN(sv.ptr, C.int(sv.len))
 		return nil, errors.New(errs)
 	}
-	queue := []event{}
+	return newModel(cModel, options)
+}
+
+func newModel(cModel *C.modelfox_model, options *LoadModelOptions) (*Model, error) {
+	modelOptions := LoadModelOptions{}
+	if options != nil {
+		modelOptions = *options
+	}
+	if modelOptions.ModelFoxURL == "" {
+		modelOptions.ModelFoxURL = "https://app.modelfox.dev"
+	}
+	var cID C.modelfox_string_view
+	C.modelfox_model_get_id(cModel, &cID)
 	model := Model{
-		cModel,
-		options,
-		queue,
+		modelPtr: cModel,
+		id:       C.GoStringN(cID.ptr, C.int(cID.len)),
+		options:  &modelOptions,
+		sampler:  newLogSampler(&modelOptions),
+		classes:  newClassTable(),
+		names:    newNameTable(),
+	}
+	C.modelfox_model_get_task(cModel, &model.task)
+	model.internClasses()
+	if err := model.startLogging(); err != nil {
+		C.modelfox_model_delete(cModel)
+		return nil, err
 	}
 	return &model, nil
 }
 
-// Destroy frees up the memory used by the model. You should call this with defer after loading your model.
-func (m Model) Destroy() {
+func (m *Model) startLogging() error {
+	timeout := defaultLogRequestTimeout
+	if m.options.LogRequestTimeout > 0 {
+		timeout = m.options.LogRequestTimeout
+	}
+	m.httpClient = &http.Client{Timeout: timeout}
+	m.logContext, m.cancelLogging = context.WithCancel(context.Background())
+	m.logger = newEventLogger(m.options, m.sendEvents)
+	if m.options.LogSpoolDir != "" {
+		spool, err := openEventSpool(m.options, m.postEvents, m.logger.handleError, &m.logger.dropped)
+		if err != nil {
+			return err
+		}
+		m.spool = spool
+	}
+	return nil
+}
+
+// Send every queued event, then stop the logger and the spool. Requests still in progress after the request timeout are cancelled, so this returns soon after that even if the app does not respond.
+func (m *Model) stopLogging() {
+	timer := time.AfterFunc(m.httpClient.Timeout, m.cancelLogging)
+	defer timer.Stop()
+	defer m.cancelLogging()
+	m.logger.close()
+	if m.spool != nil {
+		m.spool.close()
+	}
+}
+
+// Destroy frees up the memory used by the model. You should call this with defer after loading your model. This first sends every event still in the log queue to the app, or to the spool directory if `LoadModelOptions.LogSpoolDir` is set and the app cannot be reached.
+func (m *Model) Destroy() {
+	if m.modelPtr == nil {
+		return
+	}
+	m.stopLogging()
 	C.modelfox_model_delete(m.modelPtr)
+	m.modelPtr = nil
+	m.classes.destroy()
+	m.predictOptions.destroy()
+}
+
+// Warmup makes a prediction with an empty input, so that the pages of the model file and of libmodelfox touched by a prediction are resident before the first real prediction. Call it after loading the model and before serving traffic to keep that cost off the first request.
+func (m *Model) Warmup() {
+	m.PredictOne(PredictInput{}, nil)
+}
+
+// Intern the model's class names when it is loaded, in a fixed order, so that class indices are the same in every process and every class is known before the first prediction. A binary classifier predicts its negative class for an empty input with a threshold of 1, and its positive class with a threshold just above 0, which is the smallest threshold that is passed to libmodelfox. A multiclass classifier lists every class, in the model's order, in any prediction.
+func (m *Model) internClasses() {
+	switch m.task {
+	case BinaryClassificationTaskType:
+		m.PredictOne(PredictInput{}, &PredictOptions{Threshold: 1})
+		m.PredictOne(PredictInput{}, &PredictOptions{Threshold: math.SmallestNonzeroFloat32})
+	case MulticlassClassificationTaskType:
+		m.PredictOne(PredictInput{}, nil)
+	}
 }
 
 // Retrieve the model's id.
-func (m Model) ID() string {
-	var sv C.modelfox_string_view
-	C.modelfox_model_get_id(m.modelPtr, &sv)
-	id := C.GoStringN(sv.ptr, C.int(sv.len))
-	return id
+func (m *Model) ID() string {
+	return m.id
+}
+
+// Retrieve the names of the model's classes, indexed by the class indices in predict outputs. The names are shared by every predict output, so you must not modify the returned slice. Every class is known as soon as the model is loaded, and the index of a class never changes for the life of the model. For binary classification models, the negative class comes first and the positive class second. For multiclass classification models, the classes are in the same order as in the model.
+func (m *Model) Classes() []string {
+	return m.classes.load().names
+}
+
+// Retrieve the name of the class with index `index`, as written by `model.PredictInto`.
+func (m *Model) ClassName(index int) string {
+	return m.classes.load().names[index]
 }
 
-func newPredictInputVec(inputVec []PredictInput) *C.modelfox_predict_input_vec {
+func newPredictInputVec(input []PredictInput, scratch *predictScratch) *C.modelfox_predict_input_vec {
 	var cInputVec *C.modelfox_predict_input_vec
 	C.modelfox_predict_input_vec_new(&cInputVec)
-	for i := 0; i < len(inputVec); i++ {
-		cInput := newPredictInput(inputVec[i])
-		C.modelfox_predict_input_vec_push(cInputVec, cInput)
+	if len(input) == 0 {
+		return cInputVec
+	}
+	numValues := 0
+	for _, row := range input {
+		numValues += len(row)
+	}
+	// Every key and value is copied into one buffer and passed to libmodelfox with a single cgo call, and the helper frees the nul terminated copies it makes.
+	scratch.reserve(numValues+1, 2*numValues+1)
+	scratch.reserveRowLens(len(input))
+	kinds, numbers, offsets, data, rowLens := scratch.kinds, scratch.numbers, scratch.offsets, scratch.data, scratch.rowLens
+	offsets[0] = 0
+	k := 0
+	for i, row := range input {
+		rowLens[i] = C.size_t(len(row))
+		for key, value := range row {
+			data = append(data, key...)
+			offsets[2*k+1] = C.size_t(len(data))
+			kinds[k] = C.MODELFOX_GO_VALUE_NONE
+			switch value := value.(type) {
+			case string:
+				kinds[k] = C.MODELFOX_GO_VALUE_STRING
+				data = append(data, value...)
+			case float64:
+				kinds[k] = C.MODELFOX_GO_VALUE_NUMBER
+				numbers[k] = value
+			case int:
+				kinds[k] = C.MODELFOX_GO_VALUE_NUMBER
+				numbers[k] = float64(value)
+			case bool:
+				kinds[k] = C.MODELFOX_GO_VALUE_STRING
+				data = strconv.AppendBool(data, value)
+			}
+			offsets[2*k+2] = C.size_t(len(data))
+			k++
+		}
+	}
+	data = append(data, 0)
+	scratch.data = data
+	err := C.modelfox_go_predict_input_vec_push_maps(
+		cInputVec,
+		C.size_t(len(input)),
+		&rowLens[0],
+		(*C.uint8_t)(unsafe.Pointer(&kinds[0])),
+		(*C.double)(unsafe.Pointer(&numbers[0])),
+		(*C.char)(unsafe.Pointer(&data[0])),
+		&offsets[0],
+	)
+	if err != nil {
+		logModelFoxError(err)
 	}
 	return cInputVec
 }
 
-func newPredictInput(input PredictInput) *C.modelfox_predict_input {
-	var cInput *C.modelfox_predict_input
-	C.modelfox_predict_input_new(&cInput)
-	var cKey *C.char
-	defer C.free(unsafe.Pointer(cKey))
-	for key, value := range input {
-		switch value.(type) {
-		case string:
-			cKey = C.CString(key)
-			cVal := C.CString(value.(string))
-			err := C.modelfox_predict_input_set_value_string(cInput, cKey, cVal)
-			if err != nil {
-				logModelFoxError(err)
-			}
-		case float64:
-			cKey = C.CString(key)
-			cVal := C.double(float64(value.(float64)))
-			err := C.modelfox_predict_input_set_value_number(cInput, cKey, cVal)
-			if err != nil {
-				logModelFoxError(err)
-			}
-		case int:
-			cKey = C.CString(key)
-			cVal := C.double(float64(value.(int)))
-			err := C.modelfox_predict_input_set_value_number(cInput, cKey, cVal)
-			if err != nil {
-				logModelFoxError(err)
-			}
-		case bool:
-			cKey = C.CString(key)
-			cVal := C.CString(strconv.FormatBool(value.(bool)))
-			err := C.modelfox_predict_input_set_value_string(cInput, cKey, cVal)
-			if err != nil {
-				logModelFoxError(err)
+func predictColumnsLen(columns PredictColumns) int {
+	numRows := -1
+	check := func(name string, columnLen int) {
+		if numRows == -1 {
+			numRows = columnLen
+		} else if columnLen != numRows {
+			log.Fatal("modelfox error: column \"" + name + "\" has " + strconv.Itoa(columnLen) + " rows but expected " + strconv.Itoa(numRows))
+		}
+	}
+	for name, values := range columns.NumberColumns {
+		check(name, len(values))
+	}
+	for name, values := range columns.StringColumns {
+		check(name, len(values))
+	}
+	if numRows == -1 {
+		return 0
+	}
+	return numRows
+}
+
+// Retrieve the rows from `start` to `end` of the `numRows` rows in `columns`.
+func sliceColumns(columns PredictColumns, start int, end int, numRows int) PredictColumns {
+	if start == 0 && end == numRows {
+		return columns
+	}
+	chunk := PredictColumns{
+		NumberColumns: make(map[string][]float64, len(columns.NumberColumns)),
+		StringColumns: make(map[string][]string, len(columns.StringColumns)),
+	}
+	for name, values := range columns.NumberColumns {
+		chunk.NumberColumns[name] = values[start:end]
+	}
+	for name, values := range columns.StringColumns {
+		chunk.StringColumns[name] = values[start:end]
+	}
+	return chunk
+}
+
+func newPredictInputVecFromColumns(columns PredictColumns, scratch *predictScratch) *C.modelfox_predict_input_vec {
+	numRows := predictColumnsLen(columns)
+	var cInputVec *C.modelfox_predict_input_vec
+	C.modelfox_predict_input_vec_new(&cInputVec)
+	if numRows == 0 {
+		return cInputVec
+	}
+	scratch.reserveInputs(numRows)
+	cInputs := &scratch.cInputs[0]
+	C.modelfox_go_predict_inputs_new(cInputs, C.size_t(numRows))
+	for name, values := range columns.NumberColumns {
+		err := C.modelfox_go_predict_inputs_set_number_column(cInputs, C.size_t(numRows), stringView(name), (*C.double)(unsafe.Pointer(&values[0])))
+		if err != nil {
+			logModelFoxError(err)
+		}
+	}
+	scratch.reserve(0, numRows+1)
+	offsets := scratch.offsets
+	offsets[0] = 0
+	data := scratch.data
+	for name, values := range columns.StringColumns {
+		data = data[:0]
+		for i, value := range values {
+			data = append(data, value...)
+			offsets[i+1] = C.size_t(len(data))
+		}
+		// Make sure there is a valid pointer to pass even if every value is empty.
+		data = append(data, 0)
+		err := C.modelfox_go_predict_inputs_set_string_column(cInputs, C.size_t(numRows), stringView(name), (*C.char)(unsafe.Pointer(&data[0])), &offsets[0])
+		if err != nil {
+			logModelFoxError(err)
+		}
+	}
+	scratch.data = data
+	C.modelfox_go_predict_input_vec_push_all(cInputVec, cInputs, C.size_t(numRows))
+	return cInputVec
+}
+
+// Create a column schema for the columns in `columnNames`. The index of each column is its index in `columnNames`. You must call `schema.Destroy` when you are done with it.
+func NewColumnSchema(columnNames []string) *ColumnSchema {
+	schema := ColumnSchema{
+		columnNames:   append([]string{}, columnNames...),
+		columnIndices: make(map[string]int, len(columnNames)),
+	}
+	var cColumnName *C.char
+	schema.cColumnNames = (**C.char)(C.malloc(C.size_t(len(columnNames)+1) * C.size_t(unsafe.Sizeof(cColumnName))))
+	cColumnNames := (*[1 << 30]*C.char)(unsafe.Pointer(schema.cColumnNames))[:len(columnNames):len(columnNames)]
+	for i, columnName := range columnNames {
+		schema.columnIndices[columnName] = i
+		cColumnNames[i] = C.CString(columnName)
+	}
+	return &schema
+}
+
+// Destroy frees up the memory used by the column schema.
+func (s *ColumnSchema) Destroy() {
+	cColumnNames := (*[1 << 30]*C.char)(unsafe.Pointer(s.cColumnNames))[:len(s.columnNames):len(s.columnNames)]
+	for _, cColumnName := range cColumnNames {
+		C.free(unsafe.Pointer(cColumnName))
+	}
+	C.free(unsafe.Pointer(s.cColumnNames))
+	s.cColumnNames = nil
+}
+
+// Retrieve the index of the column `columnName`. The second return value is false if the schema does not contain the column.
+func (s *ColumnSchema) ColumnIndex(columnName string) (int, bool) {
+	index, ok := s.columnIndices[columnName]
+	return index, ok
+}
+
+// Retrieve the column names in the schema, in index order.
+func (s *ColumnSchema) ColumnNames() []string {
+	return s.columnNames
+}
+
+// Create a new predict input with every column unset.
+func (s *ColumnSchema) NewPredictInput() *IndexedPredictInput {
+	return &IndexedPredictInput{
+		schema:  s,
+		kinds:   make([]uint8, len(s.columnNames)),
+		numbers: make([]float64, len(s.columnNames)),
+		strings: make([]string, len(s.columnNames)),
+	}
+}
+
+// Set the value of the column at `index` to the number `value`.
+func (i *IndexedPredictInput) SetNumber(index int, value float64) {
+	i.kinds[index] = C.MODELFOX_GO_VALUE_NUMBER
+	i.numbers[index] = value
+	i.strings[index] = ""
+}
+
+// Set the value of the column at `index` to the string `value`.
+func (i *IndexedPredictInput) SetString(index int, value string) {
+	i.kinds[index] = C.MODELFOX_GO_VALUE_STRING
+	i.strings[index] = value
+}
+
+// Unset the values of all columns so the input can be reused.
+func (i *IndexedPredictInput) Reset() {
+	for index := range i.kinds {
+		i.kinds[index] = C.MODELFOX_GO_VALUE_NONE
+		i.strings[index] = ""
+	}
+}
+
+func newPredictInputVecFromIndexedPredictInputs(input []*IndexedPredictInput, scratch *predictScratch) *C.modelfox_predict_input_vec {
+	var cInputVec *C.modelfox_predict_input_vec
+	C.modelfox_predict_input_vec_new(&cInputVec)
+	if len(input) == 0 {
+		return cInputVec
+	}
+	schema := input[0].schema
+	numColumns := len(schema.columnNames)
+	numValues := len(input) * numColumns
+	// Pass at least one element so that there is always a valid pointer to each array.
+	scratch.reserve(numValues+1, numValues+1)
+	kinds, numbers, offsets, data := scratch.kinds, scratch.numbers, scratch.offsets, scratch.data
+	offsets[0] = 0
+	for i, row := range input {
+		if row.schema != schema {
+			log.Fatal("modelfox error: every indexed predict input must be created from the same column schema")
+		}
+		copy(kinds[i*numColumns:], row.kinds)
+		copy(numbers[i*numColumns:], row.numbers)
+		for j, kind := range row.kinds {
+			if kind == C.MODELFOX_GO_VALUE_STRING {
+				data = append(data, row.strings[j]...)
 			}
+			offsets[i*numColumns+j+1] = C.size_t(len(data))
 		}
 	}
-	return cInput
+	data = append(data, 0)
+	scratch.data = data
+	err := C.modelfox_go_predict_input_vec_push_rows(
+		cInputVec,
+		schema.cColumnNames,
+		C.size_t(numColumns),
+		C.size_t(len(input)),
+		(*C.uint8_t)(unsafe.Pointer(&kinds[0])),
+		(*C.double)(unsafe.Pointer(&numbers[0])),
+		(*C.char)(unsafe.Pointer(&data[0])),
+		&offsets[0],
+	)
+	if err != nil {
+		logModelFoxError(err)
+	}
+	return cInputVec
 }
 
 func newPredictOptions(predictOptions *PredictOptions) *C.modelfox_predict_options {
 	var cPredictOptions *C.modelfox_predict_options
 	C.modelfox_predict_options_new(&cPredictOptions)
 	if predictOptions != nil {
-		C.modelfox_predict_options_set_threshold(cPredictOptions, C.float(predictOptions.Threshold))
-
+		// A zero threshold means the field was not set, so libmodelfox's default is kept.
+		if predictOptions.Threshold != 0 {
+			C.modelfox_predict_options_set_threshold(cPredictOptions, C.float(predictOptions.Threshold))
+		}
 		C.modelfox_predict_options_set_compute_feature_contributions(cPredictOptions, C.bool(predictOptions.ComputeFeatureContributions))
 	}
 	return cPredictOptions
 }
 
 // Make a prediction with a single input.
-func (m Model) PredictOne(input PredictInput, options *PredictOptions) PredictOutput {
+func (m *Model) PredictOne(input PredictInput, options *PredictOptions) PredictOutput {
 	return m.Predict([]PredictInput{input}, options)[0]
 }
 
@@ -387,46 +748,382 @@ func logModelFoxError(cErr *C.modelfox_error) {
 }
 
 // Make a prediction with multiple inputs.
-func (m Model) Predict(input []PredictInput, options *PredictOptions) []PredictOutput {
-	var cOutputVec *C.modelfox_predict_output_vec
-	cInputVec := newPredictInputVec(input)
-	cOptions := newPredictOptions(options)
-	defer C.modelfox_predict_options_delete(cOptions)
+func (m *Model) Predict(input []PredictInput, options *PredictOptions) []PredictOutput {
+	outputVec := make([]PredictOutput, len(input))
+	m.predictInputs(input, options, outputVec)
+	return outputVec
+}
+
+func (m *Model) predictInputs(input []PredictInput, options *PredictOptions, outputVec []PredictOutput) {
+	predictInChunks(len(input), options, func(start int, end int) {
+		scratch := getPredictScratch()
+		defer scratch.release()
+		cInputVec := newPredictInputVec(input[start:end], scratch)
+		defer C.modelfox_predict_input_vec_delete(cInputVec)
+		m.predict(cInputVec, options, outputVec[start:end])
+	})
+}
+
+// Make predictions with a batch of inputs given column by column. This is faster than `Predict` for large batches because the values of each column are passed to libmodelfox all at once, and numeric columns are passed without being copied.
+func (m *Model) PredictColumns(columns PredictColumns, options *PredictOptions) []PredictOutput {
+	outputVec := make([]PredictOutput, predictColumnsLen(columns))
+	m.predictColumns(columns, options, outputVec)
+	return outputVec
+}
+
+func (m *Model) predictColumns(columns PredictColumns, options *PredictOptions, outputVec []PredictOutput) {
+	predictInChunks(len(outputVec), options, func(start int, end int) {
+		scratch := getPredictScratch()
+		defer scratch.release()
+		cInputVec := newPredictInputVecFromColumns(sliceColumns(columns, start, end, len(outputVec)), scratch)
+		defer C.modelfox_predict_input_vec_delete(cInputVec)
+		m.predict(cInputVec, options, outputVec[start:end])
+	})
+}
+
+// Make predictions with inputs whose values were set by column index. Every input must have been created from the same `ColumnSchema`.
+func (m *Model) PredictIndexed(input []*IndexedPredictInput, options *PredictOptions) []PredictOutput {
+	outputVec := make([]PredictOutput, len(input))
+	m.predictIndexed(input, options, outputVec)
+	return outputVec
+}
+
+func (m *Model) predictIndexed(input []*IndexedPredictInput, options *PredictOptions, outputVec []PredictOutput) {
+	predictInChunks(len(input), options, func(start int, end int) {
+		scratch := getPredictScratch()
+		defer scratch.release()
+		cInputVec := newPredictInputVecFromIndexedPredictInputs(input[start:end], scratch)
+		defer C.modelfox_predict_input_vec_delete(cInputVec)
+		m.predict(cInputVec, options, outputVec[start:end])
+	})
+}
+
+// Make predictions with multiple inputs, writing the output values to `values` and the indices of the predicted classes to `classIndices` instead of allocating a `PredictOutput` for each input. For regression, each value is the predicted value and `classIndices` may be nil. For classification, each value is the probability of the predicted class, and `model.ClassName` retrieves the name of a class from its index. Both slices must have at least one element per input.
+func (m *Model) PredictInto(input []PredictInput, options *PredictOptions, values []float32, classIndices []int) {
+	if len(values) < len(input) || (classIndices != nil && len(classIndices) < len(input)) {
+		log.Fatal("modelfox error: the output slices passed to PredictInto are shorter than the input")
+	}
+	if len(input) == 0 {
+		return
+	}
+	predictInChunks(len(input), options, func(start int, end int) {
+		var chunkClassIndices []int
+		if classIndices != nil {
+			chunkClassIndices = classIndices[start:end]
+		}
+		m.predictInto(input[start:end], options, values[start:end], chunkClassIndices)
+	})
+}
+
+func (m *Model) predictInto(input []PredictInput, options *PredictOptions, values []float32, classIndices []int) {
+	scratch := getPredictScratch()
+	defer scratch.release()
+	cInputVec := newPredictInputVec(input, scratch)
 	defer C.modelfox_predict_input_vec_delete(cInputVec)
+	cOutputVec := m.predictOutputVec(cInputVec, options)
+	defer C.modelfox_predict_output_vec_delete(cOutputVec)
+	classes := m.classes.load()
+	// Go's int has the same size as a pointer, so `classIndices` can be written to as an array of intptr_t.
+	var cClassIndices *C.intptr_t
+	if classIndices != nil && m.task != RegressionTaskType {
+		cClassIndices = (*C.intptr_t)(unsafe.Pointer(&classIndices[0]))
+	}
+	C.modelfox_go_predict_output_vec_copy_values(
+		cOutputVec,
+		m.task,
+		C.size_t(len(input)),
+		classes.cNames,
+		C.size_t(len(classes.names)),
+		(*C.float)(unsafe.Pointer(&values[0])),
+		cClassIndices,
+	)
+	if cClassIndices == nil {
+		return
+	}
+	// Classes that had not been seen yet are added to the class table.
+	for i := 0; i < len(input); i++ {
+		if classIndices[i] == -1 {
+			var cOutput *C.modelfox_predict_output
+			C.modelfox_predict_output_vec_get_at_index(cOutputVec, C.size_t(i), &cOutput)
+			if m.task == MulticlassClassificationTaskType {
+				internMulticlassClassificationClasses(m.classes, cOutput)
+			}
+			classIndices[i], _ = m.classes.intern(predictOutputClassName(m.task, cOutput))
+		}
+	}
+}
+
+// Make predictions with a multiclass classification model and return the probabilities the model assigned to each class as a row major matrix, along with its stride. The probability of class `j` for input `i` is at index `i * stride + j`, and the name of class `j` is `model.Classes()[j]`. This is much faster than `Predict` when you only need the probabilities, because no map is allocated for each input.
+func (m *Model) PredictProbabilities(input []PredictInput, options *PredictOptions) ([]float32, int) {
+	if m.task != MulticlassClassificationTaskType {
+		log.Fatal("modelfox error: PredictProbabilities requires a multiclass classification model")
+	}
+	if len(input) == 0 {
+		return nil, len(m.Classes())
+	}
+	// The number of classes is not known until the first prediction, so each chunk writes its own matrix, and the chunks are joined in order at the end.
+	chunks := make(map[int][]float32)
+	var stride int
+	var mutex sync.Mutex
+	predictInChunks(len(input), options, func(start int, end int) {
+		probabilities, chunkStride := m.predictProbabilities(input[start:end], options)
+		mutex.Lock()
+		defer mutex.Unlock()
+		chunks[start] = probabilities
+		stride = chunkStride
+	})
+	if len(chunks) == 1 || stride == 0 {
+		return chunks[0], stride
+	}
+	probabilities := make([]float32, 0, len(input)*stride)
+	for start := 0; start < len(input); start = len(probabilities) / stride {
+		probabilities = append(probabilities, chunks[start]...)
+	}
+	return probabilities, stride
+}
+
+func (m *Model) predictProbabilities(input []PredictInput, options *PredictOptions) ([]float32, int) {
+	scratch := getPredictScratch()
+	defer scratch.release()
+	cInputVec := newPredictInputVec(input, scratch)
+	defer C.modelfox_predict_input_vec_delete(cInputVec)
+	cOutputVec := m.predictOutputVec(cInputVec, options)
+	defer C.modelfox_predict_output_vec_delete(cOutputVec)
+	var cOutput *C.modelfox_predict_output
+	var cMulticlassOutput *C.modelfox_multiclass_classification_predict_output
+	var cNumClasses C.size_t
+	C.modelfox_predict_output_vec_get_at_index(cOutputVec, 0, &cOutput)
+	C.modelfox_predict_output_as_multiclass_classification(cOutput, &cMulticlassOutput)
+	C.modelfox_multiclass_classification_predict_output_get_probabilities_len(cMulticlassOutput, &cNumClasses)
+	if len(m.Classes()) < int(cNumClasses) {
+		internMulticlassClassificationClasses(m.classes, cOutput)
+	}
+	stride := int(cNumClasses)
+	probabilities := make([]float32, len(input)*stride)
+	if stride > 0 {
+		C.modelfox_go_predict_output_vec_copy_probabilities(cOutputVec, C.size_t(len(input)), cNumClasses, (*C.float)(unsafe.Pointer(&probabilities[0])))
+	}
+	return probabilities, stride
+}
+
+// Make predictions with multiple inputs and return only their feature contribution values, as dense matrices. Feature contributions are computed regardless of `options.ComputeFeatureContributions`. This is much faster than reading the feature contributions from the outputs of `Predict`, because the values of every input are copied with a single cgo call per chunk, and no entry is allocated for each feature.
+func (m *Model) PredictFeatureContributionValues(input []PredictInput, options *PredictOptions) FeatureContributionValues {
+	contributionOptions := PredictOptions{}
+	if options != nil {
+		contributionOptions = *options
+	}
+	contributionOptions.ComputeFeatureContributions = true
+	if len(input) == 0 {
+		return FeatureContributionValues{}
+	}
+	// The number of features is not known until the first prediction, so each chunk writes its own matrices, and the chunks are joined in order at the end.
+	chunks := make(map[int]FeatureContributionValues)
+	var mutex sync.Mutex
+	predictInChunks(len(input), &contributionOptions, func(start int, end int) {
+		chunk := m.predictFeatureContributionValues(input[start:end], &contributionOptions)
+		mutex.Lock()
+		defer mutex.Unlock()
+		chunks[start] = chunk
+	})
+	if len(chunks) == 1 {
+		return chunks[0]
+	}
+	first := chunks[0]
+	values := FeatureContributionValues{
+		NumClasses:     first.NumClasses,
+		NumFeatures:    first.NumFeatures,
+		BaselineValues: make([]float32, 0, len(input)*first.NumClasses),
+		OutputValues:   make([]float32, 0, len(input)*first.NumClasses),
+		Values:         make([]float32, 0, len(input)*first.NumClasses*first.NumFeatures),
+	}
+	for start := 0; start < len(input); start = len(values.BaselineValues) / values.NumClasses {
+		chunk := chunks[start]
+		values.BaselineValues = append(values.BaselineValues, chunk.BaselineValues...)
+		values.OutputValues = append(values.OutputValues, chunk.OutputValues...)
+		values.Values = append(values.Values, chunk.Values...)
+	}
+	return values
+}
+
+func (m *Model) predictFeatureContributionValues(input []PredictInput, options *PredictOptions) FeatureContributionValues {
+	scratch := getPredictScratch()
+	defer scratch.release()
+	cInputVec := newPredictInputVec(input, scratch)
+	defer C.modelfox_predict_input_vec_delete(cInputVec)
+	cOutputVec := m.predictOutputVec(cInputVec, options)
+	defer C.modelfox_predict_output_vec_delete(cOutputVec)
+	// The number of features is read from the first output.
+	var cOutput *C.modelfox_predict_output
+	var cFeatureContributions *C.modelfox_feature_contributions
+	C.modelfox_predict_output_vec_get_at_index(cOutputVec, 0, &cOutput)
+	numClasses := 1
+	switch m.task {
+	case RegressionTaskType:
+		var cRegressionOutput *C.modelfox_regression_predict_output
+		C.modelfox_predict_output_as_regression(cOutput, &cRegressionOutput)
+		C.modelfox_regression_predict_output_get_feature_contributions(cRegressionOutput, &cFeatureContributions)
+	case BinaryClassificationTaskType:
+		var cBinaryOutput *C.modelfox_binary_classification_predict_output
+		C.modelfox_predict_output_as_binary_classification(cOutput, &cBinaryOutput)
+		C.modelfox_binary_classification_predict_output_get_feature_contributions(cBinaryOutput, &cFeatureContributions)
+	case MulticlassClassificationTaskType:
+		var cMulticlassOutput *C.modelfox_multiclass_classification_predict_output
+		var cNumClasses C.size_t
+		var sv C.modelfox_string_view
+		var cFeatureContributionsIter *C.modelfox_multiclass_classification_predict_output_feature_contributions_iter
+		C.modelfox_predict_output_as_multiclass_classification(cOutput, &cMulticlassOutput)
+		C.modelfox_multiclass_classification_predict_output_get_probabilities_len(cMulticlassOutput, &cNumClasses)
+		if len(m.Classes()) < int(cNumClasses) {
+			internMulticlassClassificationClasses(m.classes, cOutput)
+		}
+		numClasses = int(cNumClasses)
+		C.modelfox_multiclass_classification_predict_output_get_feature_contributions_iter(cMulticlassOutput, &cFeatureContributionsIter)
+		if cFeatureContributionsIter != nil {
+			C.modelfox_multiclass_classification_predict_output_feature_contributions_iter_next(cFeatureContributionsIter, &sv, &cFeatureContributions)
+			C.modelfox_multiclass_classification_predict_output_feature_contributions_iter_delete(cFeatureContributionsIter)
+		}
+	}
+	var cNumFeatures C.size_t
+	if cFeatureContributions != nil {
+		C.modelfox_feature_contributions_get_entries_len(cFeatureContributions, &cNumFeatures)
+	}
+	numFeatures := int(cNumFeatures)
+	values := FeatureContributionValues{
+		NumClasses:     numClasses,
+		NumFeatures:    numFeatures,
+		BaselineValues: make([]float32, len(input)*numClasses),
+		OutputValues:   make([]float32, len(input)*numClasses),
+		Values:         make([]float32, len(input)*numClasses*numFeatures+1),
+	}
+	if numClasses > 0 {
+		C.modelfox_go_predict_output_vec_copy_feature_contribution_values(
+			cOutputVec,
+			m.task,
+			C.size_t(len(input)),
+			C.size_t(numClasses),
+			cNumFeatures,
+			(*C.float)(unsafe.Pointer(&values.BaselineValues[0])),
+			(*C.float)(unsafe.Pointer(&values.OutputValues[0])),
+			(*C.float)(unsafe.Pointer(&values.Values[0])),
+		)
+	}
+	// One extra value was allocated so that there is always a valid pointer to pass.
+	values.Values = values.Values[:len(values.Values)-1]
+	return values
+}
+
+// This is the smallest number of inputs that `predictInChunks` will give to a single goroutine, because smaller chunks spend more time starting goroutines than predicting.
+const minPredictChunkLen = 64
+
+// Split the `numRows` inputs into contiguous chunks and call `f` with the bounds of each chunk, using up to `options.NumThreads` goroutines at once. Each goroutine makes its cgo calls on its own thread, so libmodelfox predicts the chunks on separate cores. Callers write each chunk's outputs at the chunk's offset, which keeps the outputs in input order.
+func predictInChunks(numRows int, options *PredictOptions, f func(start int, end int)) {
+	numThreads := 1
+	if options != nil && options.NumThreads > 1 {
+		numThreads = options.NumThreads
+	}
+	if maxThreads := (numRows + minPredictChunkLen - 1) / minPredictChunkLen; numThreads > maxThreads {
+		numThreads = maxThreads
+	}
+	if numThreads <= 1 {
+		f(0, numRows)
+		return
+	}
+	chunkLen := (numRows + numThreads - 1) / numThreads
+	var wg sync.WaitGroup
+	for start := 0; start < numRows; start += chunkLen {
+		end := start + chunkLen
+		if end > numRows {
+			end = numRows
+		}
+		wg.Add(1)
+		go func(start int, end int) {
+			defer wg.Done()
+			f(start, end)
+		}(start, end)
+	}
+	wg.Wait()
+}
+
+func (m *Model) predictOutputVec(cInputVec *C.modelfox_predict_input_vec, options *PredictOptions) *C.modelfox_predict_output_vec {
+	var cOutputVec *C.modelfox_predict_output_vec
+	cOptions, owned := m.predictOptions.get(options)
+	if owned {
+		defer C.modelfox_predict_options_delete(cOptions)
+	}
 	err := C.modelfox_model_predict(m.modelPtr, cInputVec, cOptions, &cOutputVec)
 	if err != nil {
 		logModelFoxError(err)
 	}
-	defer C.modelfox_predict_output_vec_delete(cOutputVec)
+	return cOutputVec
+}
 
-	outputVec := make([]PredictOutput, len(input))
-	var cTaskType C.modelfox_task
-	C.modelfox_model_get_task(m.modelPtr, &cTaskType)
-	for i := 0; i < len(input); i++ {
+func (m *Model) predict(cInputVec *C.modelfox_predict_input_vec, options *PredictOptions, outputVec []PredictOutput) {
+	cOutputVec := m.predictOutputVec(cInputVec, options)
+	defer C.modelfox_predict_output_vec_delete(cOutputVec)
+	// The names of every output are interned in one batch, so the name table is copied at most once for the whole vec.
+	names := m.names.batch()
+	for i := range outputVec {
 		var cOutput *C.modelfox_predict_output
 		C.modelfox_predict_output_vec_get_at_index(cOutputVec, C.size_t(i), &cOutput)
-		outputVec[i] = makePredictOutputFromModelFoxPredictOutput(cTaskType, cOutput)
+		outputVec[i] = makePredictOutputFromModelFoxPredictOutput(m.classes, &names, m.task, featureContributionsTopK(options), cOutput)
 	}
-	return outputVec
+	names.publish()
 }
 
 // A helper function to extract a PredictOutput from a *C.modelfox_predict_output.
-func makePredictOutputFromModelFoxPredictOutput(taskType C.modelfox_task, cOutput *C.modelfox_predict_output) PredictOutput {
+func makePredictOutputFromModelFoxPredictOutput(classes *classTable, names *nameBatch, taskType C.modelfox_task, topK int, cOutput *C.modelfox_predict_output) PredictOutput {
 	switch taskType {
 	case RegressionTaskType:
-		return makeRegressionPredictOutputFromModelFoxPredictOutput(cOutput)
+		return makeRegressionPredictOutputFromModelFoxPredictOutput(names, topK, cOutput)
 	case BinaryClassificationTaskType:
-		return makeBinaryClassificationPredictOutputFromModelFoxPredictOutput(cOutput)
+		return makeBinaryClassificationPredictOutputFromModelFoxPredictOutput(classes, names, topK, cOutput)
 	case MulticlassClassificationTaskType:
-		return makeMulticlassClassificationPredictOutputFromModelFoxPredictOutput(cOutput)
+		return makeMulticlassClassificationPredictOutputFromModelFoxPredictOutput(classes, names, topK, cOutput)
 	default:
 		log.Fatal("modelfox error")
 	}
 	return nil
 }
 
+func featureContributionsTopK(options *PredictOptions) int {
+	if options == nil {
+		return 0
+	}
+	return options.FeatureContributionsTopK
+}
+
+// A helper function to retrieve the name of the predicted class from a classification *C.modelfox_predict_output.
+func predictOutputClassName(taskType C.modelfox_task, output *C.modelfox_predict_output) C.modelfox_string_view {
+	var sv C.modelfox_string_view
+	switch taskType {
+	case BinaryClassificationTaskType:
+		var cOutput *C.modelfox_binary_classification_predict_output
+		C.modelfox_predict_output_as_binary_classification(output, &cOutput)
+		C.modelfox_binary_classification_predict_output_get_class_name(cOutput, &sv)
+	case MulticlassClassificationTaskType:
+		var cOutput *C.modelfox_multiclass_classification_predict_output
+		C.modelfox_predict_output_as_multiclass_classification(output, &cOutput)
+		C.modelfox_multiclass_classification_predict_output_get_class_name(cOutput, &sv)
+	}
+	return sv
+}
+
+// A helper function to add every class of a multiclass classification *C.modelfox_predict_output to the class table, in the model's order.
+func internMulticlassClassificationClasses(classes *classTable, output *C.modelfox_predict_output) {
+	var cOutput *C.modelfox_multiclass_classification_predict_output
+	var sv C.modelfox_string_view
+	var cClassProbability C.float
+	var cProbabilitiesIter *C.modelfox_multiclass_classification_predict_output_probabilities_iter
+	C.modelfox_predict_output_as_multiclass_classification(output, &cOutput)
+	C.modelfox_multiclass_classification_predict_output_get_probabilities_iter(cOutput, &cProbabilitiesIter)
+	defer C.modelfox_multiclass_classification_predict_output_probabilities_iter_delete(cProbabilitiesIter)
+	for C.modelfox_multiclass_classification_predict_output_probabilities_iter_next(cProbabilitiesIter, &sv, &cClassProbability) {
+		classes.intern(sv)
+	}
+}
+
 // A helper function to extract a RegressionPredictOutput from a *C.modelfox_predict_output.
-func makeRegressionPredictOutputFromModelFoxPredictOutput(output *C.modelfox_predict_output) RegressionPredictOutput {
+func makeRegressionPredictOutputFromModelFoxPredictOutput(names *nameBatch, topK int, output *C.modelfox_predict_output) RegressionPredictOutput {
 	var cOutput *C.modelfox_regression_predict_output
 	var cValue C.float
 	C.modelfox_predict_output_as_regression(output, &cOutput)
@@ -435,7 +1132,7 @@ func makeRegressionPredictOutputFromModelFoxPredictOutput(output *C.modelfox_pre
 	var cFeatureContributions *C.modelfox_feature_contributions
 	C.modelfox_regression_predict_output_get_feature_contributions(cOutput, &cFeatureContributions)
 	if cFeatureContributions != nil {
-		fcs = makeFeatureContributions(cFeatureContributions)
+		fcs = makeFeatureContributions(names, topK, cFeatureContributions)
 	}
 	return RegressionPredictOutput{
 		Value:                float32(cValue),
@@ -444,45 +1141,49 @@ func makeRegressionPredictOutputFromModelFoxPredictOutput(output *C.modelfox_pre
 }
 
 // A helper function to extract a BinaryClassificationPredictOutput from a *C.modelfox_predict_output.
-func makeBinaryClassificationPredictOutputFromModelFoxPredictOutput(output *C.modelfox_predict_output) BinaryClassificationPredictOutput {
+func makeBinaryClassificationPredictOutputFromModelFoxPredictOutput(classes *classTable, names *nameBatch, topK int, output *C.modelfox_predict_output) BinaryClassificationPredictOutput {
 	var cOutput *C.modelfox_binary_classification_predict_output
 	var cProbability C.float
 	var sv C.modelfox_string_view
 	C.modelfox_predict_output_as_binary_classification(output, &cOutput)
 	C.modelfox_binary_classification_predict_output_get_probability(cOutput, &cProbability)
 	C.modelfox_binary_classification_predict_output_get_class_name(cOutput, &sv)
-	className := C.GoStringN(sv.ptr, C.int(sv.len))
+	classIndex, className := classes.intern(sv)
 	var fcs FeatureContributions
 	var cFeatureContributions *C.modelfox_feature_contributions
 	C.modelfox_binary_classification_predict_output_get_feature_contributions(cOutput, &cFeatureContributions)
 	if cFeatureContributions != nil {
-		fcs = makeFeatureContributions(cFeatureContributions)
+		fcs = makeFeatureContributions(names, topK, cFeatureContributions)
 	}
 	return BinaryClassificationPredictOutput{
 		ClassName:            className,
+		ClassIndex:           classIndex,
 		Probability:          float32(cProbability),
 		FeatureContributions: fcs,
 	}
 }
 
 // A helper function to extract a MulticlassClassificationPredictOutput from a *C.modelfox_predict_output.
-func makeMulticlassClassificationPredictOutputFromModelFoxPredictOutput(output *C.modelfox_predict_output) MulticlassClassificationPredictOutput {
+func makeMulticlassClassificationPredictOutputFromModelFoxPredictOutput(classes *classTable, names *nameBatch, topK int, output *C.modelfox_predict_output) MulticlassClassificationPredictOutput {
 	var cOutput *C.modelfox_multiclass_classification_predict_output
 	var cProbability C.float
 	var sv C.modelfox_string_view
 	C.modelfox_predict_output_as_multiclass_classification(output, &cOutput)
 	C.modelfox_multiclass_classification_predict_output_get_probability(cOutput, &cProbability)
-	C.modelfox_multiclass_classification_predict_output_get_class_name(cOutput, &sv)
-	predictedClassName := C.GoStringN(sv.ptr, C.int(sv.len))
+	// The probabilities iterator visits every class in the model's order, so interning its class names before the predicted class name gives the classes the same indices as in the model.
 	var cClassProbability C.float
+	var cProbabilitiesLen C.size_t
 	var cProbabilitiesIter *C.modelfox_multiclass_classification_predict_output_probabilities_iter
+	C.modelfox_multiclass_classification_predict_output_get_probabilities_len(cOutput, &cProbabilitiesLen)
 	C.modelfox_multiclass_classification_predict_output_get_probabilities_iter(cOutput, &cProbabilitiesIter)
 	defer C.modelfox_multiclass_classification_predict_output_probabilities_iter_delete(cProbabilitiesIter)
-	probabilities := make(map[string]float32)
+	probabilities := make(map[string]float32, int(cProbabilitiesLen))
 	for C.modelfox_multiclass_classification_predict_output_probabilities_iter_next(cProbabilitiesIter, &sv, &cClassProbability) {
-		className := C.GoStringN(sv.ptr, C.int(sv.len))
+		_, className := classes.intern(sv)
 		probabilities[className] = float32(cClassProbability)
 	}
+	C.modelfox_multiclass_classification_predict_output_get_class_name(cOutput, &sv)
+	predictedClassIndex, predictedClassName := classes.intern(sv)
 	var cFeatureContributionsIter *C.modelfox_multiclass_classification_predict_output_feature_contributions_iter
 	C.modelfox_multiclass_classification_predict_output_get_feature_contributions_iter(cOutput, &cFeatureContributionsIter)
 	defer C.modelfox_multiclass_classification_predict_output_feature_contributions_iter_delete(cFeatureContributionsIter)
@@ -490,32 +1191,54 @@ func makeMulticlassClassificationPredictOutputFromModelFoxPredictOutput(output *
 	if cFeatureContributionsIter != nil {
 		var cFeatureContributions *C.modelfox_feature_contributions
 		for C.modelfox_multiclass_classification_predict_output_feature_contributions_iter_next(cFeatureContributionsIter, &sv, &cFeatureContributions) {
-			className := C.GoStringN(sv.ptr, C.int(sv.len))
-			featureContributions[className] = makeFeatureContributions(cFeatureContributions)
+			_, className := classes.intern(sv)
+			featureContributions[className] = makeFeatureContributions(names, topK, cFeatureContributions)
 		}
 	}
 
 	return MulticlassClassificationPredictOutput{
 		ClassName:            predictedClassName,
+		ClassIndex:           predictedClassIndex,
 		Probability:          float32(cProbability),
 		Probabilities:        probabilities,
 		FeatureContributions: featureContributions,
 	}
 }
 
-// FeatureContributions returns the FeatureContributions from a RegressionPredictOutput.
-func makeFeatureContributions(cfcs *C.modelfox_feature_contributions) FeatureContributions {
-	var len C.size_t
-	C.modelfox_feature_contributions_get_entries_len(cfcs, &len)
-	featureContributions := make([]FeatureContributionEntry, int(len))
+var featureContributionEntryBufferPool = sync.Pool{
+	New: func() interface{} {
+		return new([]C.modelfox_go_feature_contribution_entry)
+	},
+}
+
+// A helper function to extract a FeatureContributions from a *C.modelfox_feature_contributions. Every entry is copied with a single cgo call, and the names in the entries are interned in `names`. If `topK` is greater than zero, only the `topK` entries with the largest absolute values are copied.
+func makeFeatureContributions(names *nameBatch, topK int, cfcs *C.modelfox_feature_contributions) FeatureContributions {
+	var cLen C.size_t
+	C.modelfox_feature_contributions_get_entries_len(cfcs, &cLen)
+	numEntries := int(cLen)
+	if topK > 0 && topK < numEntries {
+		numEntries = topK
+	}
 	var baseline C.float
 	C.modelfox_feature_contributions_get_baseline_value(cfcs, &baseline)
 	var output C.float
 	C.modelfox_feature_contributions_get_output_value(cfcs, &output)
-	var cFeatureContribution *C.modelfox_feature_contribution_entry
-	for i := range featureContributions {
-		C.modelfox_feature_contributions_get_entry_at_index(cfcs, C.size_t(i), &cFeatureContribution)
-		featureContributions[i] = makeFeatureContribution(cFeatureContribution)
+	featureContributions := make([]FeatureContributionEntry, numEntries)
+	if numEntries > 0 {
+		buf := featureContributionEntryBufferPool.Get().(*[]C.modelfox_go_feature_contribution_entry)
+		defer featureContributionEntryBufferPool.Put(buf)
+		if cap(*buf) < numEntries {
+			*buf = make([]C.modelfox_go_feature_contribution_entry, numEntries)
+		}
+		cEntries := (*buf)[:numEntries]
+		if topK > 0 {
+			C.modelfox_go_feature_contributions_copy_top_entries(cfcs, cLen, C.size_t(topK), &cEntries[0])
+		} else {
+			C.modelfox_go_feature_contributions_copy_entries(cfcs, cLen, &cEntries[0])
+		}
+		for i := range cEntries {
+			featureContributions[i] = makeFeatureContribution(names, &cEntries[i])
+		}
 	}
 	return FeatureContributions{
 		BaselineValue: float32(baseline),
@@ -524,217 +1247,245 @@ func makeFeatureContributions(cfcs *C.modelfox_feature_contributions) FeatureCon
 	}
 }
 
-func makeFeatureContribution(f *C.modelfox_feature_contribution_entry) FeatureContributionEntry {
-	var cType C.modelfox_feature_contribution_entry_type
-
-	C.modelfox_feature_contribution_entry_get_type(f, &cType)
-	switch cType {
+func makeFeatureContribution(names *nameBatch, f *C.modelfox_go_feature_contribution_entry) FeatureContributionEntry {
+	switch f._type {
 	case IdentityFeatureContributionType:
-		return makeIdentityFeatureContribution(f)
+		return IdentityFeatureContribution{
+			ColumnName:               names.intern(f.column_name),
+			FeatureValue:             float32(f.feature_value),
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	case NormalizedFeatureContributionType:
-		return makeNormalizedFeatureContribution(f)
+		return NormalizedFeatureContribution{
+			ColumnName:               names.intern(f.column_name),
+			FeatureValue:             float32(f.feature_value),
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	case OneHotEncodedFeatureContributionType:
-		return makeOneHotEncodedFeatureContribution(f)
+		return OneHotEncodedFeatureContribution{
+			ColumnName:               names.intern(f.column_name),
+			Variant:                  names.intern(f.variant),
+			FeatureValue:             f.feature_value != 0,
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	case BagOfWordsFeatureContributionType:
-		return makeBagOfWordsFeatureContribution(f)
+		return BagOfWordsFeatureContribution{
+			ColumnName:               names.intern(f.column_name),
+			NGram:                    makeNGram(names, f),
+			FeatureValue:             float32(f.feature_value),
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	case BagOfWordsCosineSimilarityFeatureContributionType:
-		return makeBagOfWordsCosineSimilarityFeatureContribution(f)
+		return BagOfWordsCosineSimilarityFeatureContribution{
+			ColumnNameA:              names.intern(f.column_name),
+			ColumnNameB:              names.intern(f.column_name_b),
+			FeatureValue:             float32(f.feature_value),
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	case WordEmbeddingFeatureContributionType:
-		return makeWordEmbeddingFeatureContribution(f)
+		return WordEmbeddingFeatureContribution{
+			ColumnName:               names.intern(f.column_name),
+			ValueIndex:               int(f.value_index),
+			FeatureContributionValue: float32(f.feature_contribution_value),
+		}
 	}
 	return nil
 }
 
-func makeIdentityFeatureContribution(f *C.modelfox_feature_contribution_entry) IdentityFeatureContribution {
-	var cFeatureContribution *C.modelfox_identity_feature_contribution
-	var cColumnName C.modelfox_string_view
-	var cFeatureValue C.float
-	var cFeatureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_identity(f, &cFeatureContribution)
-	C.modelfox_identity_feature_contribution_get_column_name(cFeatureContribution, &cColumnName)
-	C.modelfox_identity_feature_contribution_get_feature_value(cFeatureContribution, &cFeatureValue)
-	C.modelfox_identity_feature_contribution_get_feature_contribution_value(cFeatureContribution, &cFeatureContributionValue)
-	return IdentityFeatureContribution{
-		ColumnName:               C.GoStringN(cColumnName.ptr, C.int(cColumnName.len)),
-		FeatureContributionValue: float32(cFeatureContributionValue),
-		FeatureValue:             float32(cFeatureValue),
-	}
-}
-
-func makeNormalizedFeatureContribution(f *C.modelfox_feature_contribution_entry) NormalizedFeatureContribution {
-	var cFeatureContribution *C.modelfox_normalized_feature_contribution
-	var cColumnName C.modelfox_string_view
-	var featureValue C.float
-	var featureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_normalized(f, &cFeatureContribution)
-	C.modelfox_normalized_feature_contribution_get_column_name(cFeatureContribution, &cColumnName)
-	C.modelfox_normalized_feature_contribution_get_feature_value(cFeatureContribution, &featureValue)
-	C.modelfox_normalized_feature_contribution_get_feature_contribution_value(cFeatureContribution, &featureContributionValue)
-	return NormalizedFeatureContribution{
-		ColumnName:               C.GoStringN(cColumnName.ptr, C.int(cColumnName.len)),
-		FeatureValue:             float32(featureValue),
-		FeatureContributionValue: float32(featureContributionValue),
-	}
-}
-
-func makeOneHotEncodedFeatureContribution(f *C.modelfox_feature_contribution_entry) OneHotEncodedFeatureContribution {
-	var cFeatureContribution *C.modelfox_one_hot_encoded_feature_contribution
-	var cColumnName C.modelfox_string_view
-	var cVariant C.modelfox_string_view
-	var cFeatureValue C.bool
-	var cFeatureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_one_hot_encoded(f, &cFeatureContribution)
-	C.modelfox_one_hot_encoded_feature_contribution_get_column_name(cFeatureContribution, &cColumnName)
-	C.modelfox_one_hot_encoded_feature_contribution_get_variant(cFeatureContribution, &cVariant)
-	C.modelfox_one_hot_encoded_feature_contribution_get_feature_value(cFeatureContribution, &cFeatureValue)
-	C.modelfox_one_hot_encoded_feature_contribution_get_feature_contribution_value(cFeatureContribution, &cFeatureContributionValue)
-	return OneHotEncodedFeatureContribution{
-		ColumnName:               C.GoStringN(cColumnName.ptr, C.int(cColumnName.len)),
-		Variant:                   C.GoStringN(cVariant.ptr, C.int(cVariant.len)),
-		FeatureContributionValue: float32(cFeatureContributionValue),
-		FeatureValue:             bool(cFeatureValue),
-	}
-}
-
-func makeBagOfWordsFeatureContribution(f *C.modelfox_feature_contribution_entry) BagOfWordsFeatureContribution {
-	var cFeatureContribution *C.modelfox_bag_of_words_feature_contribution
-	var cColumnName C.modelfox_string_view
-	var cNGram *C.modelfox_ngram
-	var cFeatureValue C.float
-	var cFeatureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_bag_of_words(f, &cFeatureContribution)
-	C.modelfox_bag_of_words_feature_contribution_get_column_name(cFeatureContribution, &cColumnName)
-	C.modelfox_bag_of_words_feature_contribution_get_feature_contribution_value(cFeatureContribution, &cFeatureContributionValue)
-	C.modelfox_bag_of_words_feature_contribution_get_ngram(cFeatureContribution, &cNGram)
-	C.modelfox_bag_of_words_feature_contribution_get_feature_value(cFeatureContribution, &cFeatureValue)
-	return BagOfWordsFeatureContribution{
-		ColumnName:               C.GoStringN(cColumnName.ptr, C.int(cColumnName.len)),
-		NGram:                    makeNGram(cNGram),
-		FeatureContributionValue: float32(cFeatureContributionValue),
-		FeatureValue:             float32(cFeatureValue),
-	}
-}
-
 const (
 	UnigramType = iota
 	BigramType
 )
 
-func makeNGram(n *C.modelfox_ngram) NGram {
-	var cType C.modelfox_ngram_type
-	C.modelfox_ngram_get_type(n, &cType)
-	switch cType {
+func makeNGram(names *nameBatch, f *C.modelfox_go_feature_contribution_entry) NGram {
+	switch f.ngram_type {
 	case UnigramType:
-		return makeUnigramNGram(n)
+		return Unigram{
+			Token: names.intern(f.token_a),
+		}
 	case BigramType:
-		return makeBigramNGram(n)
+		return Bigram{
+			TokenA: names.intern(f.token_a),
+			TokenB: names.intern(f.token_b),
+		}
 	}
 	return nil
 }
 
-func makeUnigramNGram(n *C.modelfox_ngram) Unigram {
-	var cToken C.modelfox_string_view
-	C.modelfox_unigram_get_token(n, &cToken)
-	return Unigram{
-		Token: C.GoStringN(cToken.ptr, C.int(cToken.len)),
+// Send a prediction event to the app. If you want to batch events, you can use `model.EnqueueLogPrediction` instead. If background logging is enabled, the event is queued and this returns nil immediately.
+func (m *Model) LogPrediction(args LogPredictionArgs) error {
+	if !m.shouldLog(args.Identifier) {
+		return nil
 	}
+	return m.logEvent(m.predictionEvent(args))
 }
 
-func makeBigramNGram(n *C.modelfox_ngram) Bigram {
-	var cTokenA C.modelfox_string_view
-	var cTokenB C.modelfox_string_view
-	C.modelfox_bigram_get_token_a(n, &cTokenA)
-	C.modelfox_bigram_get_token_b(n, &cTokenB)
-	return Bigram{
-		TokenA: C.GoStringN(cTokenA.ptr, C.int(cTokenA.len)),
-		TokenB: C.GoStringN(cTokenB.ptr, C.int(cTokenB.len)),
+// Add a prediction event to the queue. Remember to call `model.FlushLogQueue` at a later point to send the event to the app. Once `LoadModelOptions.LogBatchSize` events are queued, they are sent in the background without waiting for `model.FlushLogQueue`.
+func (m *Model) EnqueueLogPrediction(args LogPredictionArgs) {
+	if !m.shouldLog(args.Identifier) {
+		return
 	}
+	m.enqueueEvent(m.predictionEvent(args))
 }
 
-func makeBagOfWordsCosineSimilarityFeatureContribution(f *C.modelfox_feature_contribution_entry) BagOfWordsCosineSimilarityFeatureContribution {
-	var cFeatureContribution *C.modelfox_bag_of_words_cosine_similarity_feature_contribution
-	var cColumnNameA C.modelfox_string_view
-	var cColumnNameB C.modelfox_string_view
-	var cFeatureValue C.float
-	var cFeatureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_bag_of_words_cosine_similarity(f, &cFeatureContribution)
-	C.modelfox_bag_of_words_cosine_similarity_feature_contribution_get_column_name_a(cFeatureContribution, &cColumnNameA)
-	C.modelfox_bag_of_words_cosine_similarity_feature_contribution_get_column_name_b(cFeatureContribution, &cColumnNameB)
-	C.modelfox_bag_of_words_cosine_similarity_feature_contribution_get_feature_contribution_value(cFeatureContribution, &cFeatureContributionValue)
-	C.modelfox_bag_of_words_cosine_similarity_feature_contribution_get_feature_value(cFeatureContribution, &cFeatureValue)
-	return BagOfWordsCosineSimilarityFeatureContribution{
-		ColumnNameA:               C.GoStringN(cColumnNameA.ptr, C.int(cColumnNameA.len)),
-		ColumnNameB:               C.GoStringN(cColumnNameB.ptr, C.int(cColumnNameB.len)),
-		FeatureContributionValue: float32(cFeatureContributionValue),
-		FeatureValue:             float32(cFeatureValue),
+// Send a true value event to the app. If you want to batch events, you can use `model.EnqueueLogTrueValue` instead. If background logging is enabled, the event is queued and this returns nil immediately.
+func (m *Model) LogTrueValue(args LogTrueValueArgs) error {
+	if !m.shouldLog(args.Identifier) {
+		return nil
 	}
+	return m.logEvent(m.trueValueEvent(args))
 }
 
-func makeWordEmbeddingFeatureContribution(f *C.modelfox_feature_contribution_entry) WordEmbeddingFeatureContribution {
-	var cFeatureContribution *C.modelfox_word_embedding_feature_contribution
-	var cColumnName C.modelfox_string_view
-	var cValueIndex C.size_t
-	var cFeatureContributionValue C.float
-	C.modelfox_feature_contribution_entry_as_word_embedding(f, &cFeatureContribution)
-	C.modelfox_word_embedding_feature_contribution_get_column_name(cFeatureContribution, &cColumnName)
-	C.modelfox_word_embedding_feature_contribution_get_feature_contribution_value(cFeatureContribution, &cFeatureContributionValue)
-	C.modelfox_word_embedding_feature_contribution_get_value_index(cFeatureContribution, &cValueIndex)
-	return WordEmbeddingFeatureContribution{
-		ColumnName:               C.GoStringN(cColumnName.ptr, C.int(cColumnName.len)),
-		ValueIndex:               int(cValueIndex),
-		FeatureContributionValue: float32(cFeatureContributionValue),
+// Add a true value event to the queue. Remember to call `model.FlushLogQueue` at a later point to send the event to the app. Once `LoadModelOptions.LogBatchSize` events are queued, they are sent in the background without waiting for `model.FlushLogQueue`.
+func (m *Model) EnqueueLogTrueValue(args LogTrueValueArgs) {
+	if !m.shouldLog(args.Identifier) {
+		return
 	}
+	m.enqueueEvent(m.trueValueEvent(args))
 }
 
-// Send a prediction event to the app. If you want to batch events, you can use `model.EnqueueLogPrediction` instead.
-func (m Model) LogPrediction(args LogPredictionArgs) error {
-	return m.logEvent(m.predictionEvent(args))
+// Send all events in the queue to the app. If the app cannot be reached or responds with a server error, the events are kept and sent again by the next flush. If the app rejects the events, they are dropped, and the error is returned only by this flush.
+func (m *Model) FlushLogQueue() error {
+	return m.logger.flush()
 }
 
-// Add a prediction event to the queue. Remember to call `model.FlushLogQueue` at a later point to send the event to the app.
-func (m Model) EnqueueLogPrediction(args LogPredictionArgs) {
-	m.logQueue = append(m.logQueue, m.predictionEvent(args))
+// Determine whether to log the event with `identifier`, following `LoadModelOptions.LogSampleRate` and `LoadModelOptions.LogRateLimit`. This is checked before the event is built, so events that are not logged cost almost nothing.
+func (m *Model) shouldLog(identifier string) bool {
+	if !m.sampler.sampled(identifier) {
+		return false
+	}
+	if !m.sampler.allowed() {
+		atomic.AddUint64(&m.logger.dropped, 1)
+		return false
+	}
+	return true
 }
 
-//  Send a true value event to the app. If you want to batch events, you can use `model.EnqueueLogTrueValue` instead.
-func (m Model) LogTrueValue(args LogTrueValueArgs) error {
-	return m.logEvent(m.trueValueEvent(args))
+func (m *Model) logEvent(e event) error {
+	if m.options.BackgroundLogging {
+		m.enqueueEvent(e)
+		return nil
+	}
+	return m.logEvents([]event{e})
 }
 
-// Add a true value event to the queue. Remember to call `model.FlushLogQueue` at a later point to send the event to the app.
-func (m Model) EnqueueLogTrueValue(args LogTrueValueArgs) {
-	m.logQueue = append(m.logQueue, m.trueValueEvent(args))
+// Queued events are encoded later on the logger's goroutine, so the input is copied first, because the caller may reuse or modify its map as soon as logging returns.
+func (m *Model) enqueueEvent(e event) {
+	if e.input != nil {
+		input := make(PredictInput, len(e.input))
+		for key, value := range e.input {
+			input[key] = value
+		}
+		e.input = input
+	}
+	m.logger.enqueue(e)
 }
 
-// Send all events in the queue to the app.
-func (m Model) FlushLogQueue() error {
-	err := m.logEvents(m.logQueue)
-	if err != nil {
-		return err
-	}
-	m.logQueue = []event{}
+// Retrieve the number of events that were dropped because the log queue was full, because they exceeded `LoadModelOptions.LogRateLimit`, because they could not be encoded or were rejected by the app, or because the spool directory reached `LoadModelOptions.LogSpoolMaxBytes`. Events left out by `LoadModelOptions.LogSampleRate` are not counted.
+func (m *Model) DroppedLogEvents() uint64 {
+	return atomic.LoadUint64(&m.logger.dropped)
+}
+
+var logBufferPool = sync.Pool{
+	New: func() interface{} {
+		return new([]byte)
+	},
+}
+
+var requestBodyPool = sync.Pool{
+	New: func() interface{} {
+		return new(bytes.Buffer)
+	},
+}
+
+// A requestBody is the body of a request to the app, held in a pooled buffer. The HTTP client may keep reading a request body after `Do` returns, for example when the app responds before reading all of it, so the buffer is only returned to the pool once the client closes the body.
+type requestBody struct {
+	*bytes.Reader
+	buf       *bytes.Buffer
+	closeOnce sync.Once
+}
+
+func newRequestBody() *requestBody {
+	buf := requestBodyPool.Get().(*bytes.Buffer)
+	buf.Reset()
+	return &requestBody{buf: buf}
+}
+
+func (b *requestBody) Close() error {
+	b.closeOnce.Do(func() {
+		if b.buf.Cap() <= maxRetainedLogBatchLen {
+			requestBodyPool.Put(b.buf)
+		}
+	})
 	return nil
 }
 
-func (m Model) logEvent(e event) error {
-	return m.logEvents([]event{e})
+var gzipWriterPool = sync.Pool{
+	New: func() interface{} {
+		return gzip.NewWriter(nil)
+	},
 }
 
-func (m Model) logEvents(events []event) error {
-	body, err := json.Marshal(events)
+func (m *Model) logEvents(events []event) error {
+	buf := logBufferPool.Get().(*[]byte)
+	body, err := appendEventsJSON((*buf)[:0], events)
+	defer func() {
+		// Keep the buffer for the next batch only if it is a reasonable size.
+		if cap(body) <= maxRetainedLogBatchLen {
+			*buf = body[:0]
+		}
+		logBufferPool.Put(buf)
+	}()
 	if err != nil {
 		return err
 	}
-	req, err := http.NewRequest(
+	return m.sendEvents(body, len(events))
+}
+
+// Send a JSON encoded array of `numEvents` events to the app, or to the spool if there is one.
+func (m *Model) sendEvents(body []byte, numEvents int) error {
+	if m.spool != nil {
+		return m.spool.send(body, numEvents)
+	}
+	return m.postEvents(body)
+}
+
+// Send a JSON encoded array of events to the app. `body` is copied into the request, so the caller may reuse it as soon as this returns.
+func (m *Model) postEvents(body []byte) error {
+	reqBody := newRequestBody()
+	if m.options.CompressLogs {
+		gz := gzipWriterPool.Get().(*gzip.Writer)
+		defer gzipWriterPool.Put(gz)
+		gz.Reset(reqBody.buf)
+		if _, err := gz.Write(body); err != nil {
+			reqBody.Close()
+			return err
+		}
+		if err := gz.Close(); err != nil {
+			reqBody.Close()
+			return err
+		}
+	} else {
+		reqBody.buf.Write(body)
+	}
+	reqBody.Reader = bytes.NewReader(reqBody.buf.Bytes())
+	req, err := http.NewRequestWithContext(
+		m.logContext,
 		"POST",
 		m.options.ModelFoxURL+"/track",
-		bytes.NewReader(body),
+		reqBody,
 	)
 	if err != nil {
+		reqBody.Close()
 		return err
 	}
+	// The length is only set automatically for bodies of standard types.
+	req.ContentLength = int64(reqBody.Len())
 	req.Header.Set("Content-Type", "application/json")
-	res, err := http.DefaultClient.Do(req)
+	if m.options.CompressLogs {
+		req.Header.Set("Content-Encoding", "gzip")
+	}
+	res, err := m.httpClient.Do(req)
 	if err != nil {
 		return err
 	}
@@ -744,29 +1495,29 @@ func (m Model) logEvents(events []event) error {
 		if err != nil {
 			return err
 		}
-		return errors.New(string(body))
+		return &logResponseError{statusCode: res.StatusCode, message: string(body)}
 	}
 	return nil
 }
 
-func (m Model) predictionEvent(args LogPredictionArgs) event {
+func (m *Model) predictionEvent(args LogPredictionArgs) event {
 	return event{
-		"date":       time.Now().Format(time.RFC3339),
-		"identifier": args.Identifier,
-		"input":      args.Input,
-		"modelId":    m.ID(),
-		"options":    args.Options,
-		"output":     args.Output,
-		"type":       "prediction",
+		eventType:  predictionEventType,
+		date:       time.Now(),
+		identifier: args.Identifier,
+		modelID:    m.id,
+		input:      args.Input,
+		options:    args.Options,
+		output:     args.Output,
 	}
 }
 
-func (m Model) trueValueEvent(args LogTrueValueArgs) event {
+func (m *Model) trueValueEvent(args LogTrueValueArgs) event {
 	return event{
-		"date":       time.Now().Format(time.RFC3339),
-		"identifier": args.Identifier,
-		"modelId":    m.ID(),
-		"trueValue":  args.TrueValue,
-		"type":       "true_value",
+		eventType:  trueValueEventType,
+		date:       time.Now(),
+		identifier: args.Identifier,
+		modelID:    m.id,
+		trueValue:  args.TrueValue,
 	}
 }
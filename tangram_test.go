@@ -0,0 +1,309 @@
+package modelfox
+
+import (
+	"net/http"
+	"net/http/httptest"
+	"os"
+	"reflect"
+	"runtime"
+	"runtime/debug"
+	"strconv"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+)
+
+// Tests that make predictions load the model at the path in the MODELFOX_TEST_MODEL environment variable, and are skipped if it is not set. The inputs match the heart disease model used in the examples.
+func loadTestModel(tb testing.TB, options *LoadModelOptions) *Model {
+	tb.Helper()
+	path := os.Getenv("MODELFOX_TEST_MODEL")
+	if path == "" {
+		tb.Skip("MODELFOX_TEST_MODEL is not set")
+	}
+	model, err := LoadModelFromPath(path, options)
+	if err != nil {
+		tb.Fatal(err)
+	}
+	return model
+}
+
+func testInputs(numRows int) []PredictInput {
+	input := make([]PredictInput, numRows)
+	for i := range input {
+		input[i] = PredictInput{
+			"age":                                  float64(30 + i%50),
+			"gender":                               "male",
+			"chest_pain":                           "typical angina",
+			"resting_blood_pressure":               float64(120 + i%40),
+			"cholesterol":                          float64(180 + i%100),
+			"fasting_blood_sugar_greater_than_120": "true",
+			"resting_ecg_result":                   "probable or definite left ventricular hypertrophy",
+			"exercise_max_heart_rate":              float64(110 + i%80),
+			"exercise_induced_angina":              "no",
+			"exercise_st_depression":               float64(i%40) / 10,
+			"exercise_st_slope":                    "downsloping",
+			"fluoroscopy_vessels_colored":          "0",
+			"thallium_stress_test":                 "fixed defect",
+		}
+	}
+	return input
+}
+
+func TestPredictOptionsWithoutThreshold(t *testing.T) {
+	model := loadTestModel(t, nil)
+	defer model.Destroy()
+	input := testInputs(1000)
+	want := model.Predict(input, nil)
+	for _, options := range []PredictOptions{{NumThreads: 4}, {FeatureContributionsTopK: 3}, {Threshold: 0.5}} {
+		got := model.Predict(input, &options)
+		for i := range want {
+			if outputClassName(got[i]) != outputClassName(want[i]) {
+				t.Fatalf("options %+v changed the output for input %d", options, i)
+			}
+		}
+	}
+}
+
+func TestClassesAreKnownWhenLoaded(t *testing.T) {
+	model := loadTestModel(t, nil)
+	defer model.Destroy()
+	classes := append([]string{}, model.Classes()...)
+	output, ok := model.PredictOne(PredictInput{}, &PredictOptions{Threshold: 1}).(BinaryClassificationPredictOutput)
+	if !ok {
+		t.Skip("the test model is not a binary classifier")
+	}
+	if len(classes) != 2 || output.ClassIndex != 0 || output.ClassName != classes[0] {
+		t.Fatalf("expected the negative class first, got classes %v and output %+v", classes, output)
+	}
+	model.Predict(testInputs(100), nil)
+	if len(model.Classes()) != 2 {
+		t.Fatalf("predictions added classes %v", model.Classes())
+	}
+}
+
+// Read the resident set size of the process, after returning as much of the Go heap to the operating system as possible, so that growth between readings comes from memory allocated outside Go.
+func residentBytes(t *testing.T) int64 {
+	t.Helper()
+	runtime.GC()
+	debug.FreeOSMemory()
+	statm, err := os.ReadFile("/proc/self/statm")
+	if err != nil {
+		t.Skip("the resident set size is only read on Linux")
+	}
+	fields := strings.Fields(string(statm))
+	if len(fields) < 2 {
+		t.Fatalf("unexpected /proc/self/statm contents %q", statm)
+	}
+	pages, err := strconv.ParseInt(fields[1], 10, 64)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return pages * int64(os.Getpagesize())
+}
+
+// Make a million predictions with string inputs and check that the resident set size stays flat. Every input cell used to leak a C string, which grew the C heap by about a kilobyte per row.
+func TestPredictDoesNotLeak(t *testing.T) {
+	if testing.Short() {
+		t.Skip("the leak test is skipped in short mode")
+	}
+	model := loadTestModel(t, nil)
+	defer model.Destroy()
+	input := testInputs(1000)
+	for i, row := range input {
+		// Make every string value distinct, as in real traffic.
+		row["chest_pain"] = "typical angina " + strconv.Itoa(i)
+	}
+	const numCheckpoints = 10
+	const batchesPerCheckpoint = 100
+	// Predict once before the first reading, so that the pools and libmodelfox's own buffers are already allocated.
+	for i := 0; i < batchesPerCheckpoint; i++ {
+		model.Predict(input, nil)
+	}
+	start := residentBytes(t)
+	for checkpoint := 1; checkpoint <= numCheckpoints; checkpoint++ {
+		for i := 0; i < batchesPerCheckpoint; i++ {
+			model.Predict(input, nil)
+		}
+		resident := residentBytes(t)
+		t.Logf("resident set size after %d predictions: %d bytes", checkpoint*batchesPerCheckpoint*len(input), resident)
+		if growth := resident - start; growth > 64<<20 {
+			t.Fatalf("the resident set size grew by %d bytes over %d predictions", growth, checkpoint*batchesPerCheckpoint*len(input))
+		}
+	}
+}
+
+// Retrieve the feature contributions of each class of a predict output, in the order of `model.Classes()` for multiclass classification.
+func outputFeatureContributions(model *Model, output PredictOutput) []FeatureContributions {
+	switch output := output.(type) {
+	case RegressionPredictOutput:
+		return []FeatureContributions{output.FeatureContributions}
+	case BinaryClassificationPredictOutput:
+		return []FeatureContributions{output.FeatureContributions}
+	case MulticlassClassificationPredictOutput:
+		var featureContributions []FeatureContributions
+		for _, className := range model.Classes() {
+			featureContributions = append(featureContributions, output.FeatureContributions[className])
+		}
+		return featureContributions
+	}
+	return nil
+}
+
+func TestFeatureContributionsView(t *testing.T) {
+	model := loadTestModel(t, nil)
+	defer model.Destroy()
+	input := testInputs(20)
+	want := model.Predict(input, &PredictOptions{ComputeFeatureContributions: true})
+	view := model.PredictFeatureContributionsView(input, nil)
+	defer view.Close()
+	if view.NumInputs() != len(input) {
+		t.Fatalf("the view has %d inputs, expected %d", view.NumInputs(), len(input))
+	}
+	for i := range input {
+		wantClasses := outputFeatureContributions(model, want[i])
+		if view.NumClasses() != len(wantClasses) {
+			t.Fatalf("the view has %d classes, expected %d", view.NumClasses(), len(wantClasses))
+		}
+		for c, wantFeatureContributions := range wantClasses {
+			if view.BaselineValue(i, c) != wantFeatureContributions.BaselineValue || view.OutputValue(i, c) != wantFeatureContributions.OutputValue {
+				t.Fatalf("the baseline and output values of input %d and class %d differ from the predict output", i, c)
+			}
+			if view.NumEntries(i, c) != len(wantFeatureContributions.Entries) {
+				t.Fatalf("input %d and class %d have %d entries, expected %d", i, c, view.NumEntries(i, c), len(wantFeatureContributions.Entries))
+			}
+			values := make([]float32, view.NumEntries(i, c))
+			view.CopyValues(i, c, values)
+			for j, wantEntry := range wantFeatureContributions.Entries {
+				if entry := view.Entry(i, c, j); !reflect.DeepEqual(entry, wantEntry) {
+					t.Fatalf("entry %d of input %d and class %d is %+v, expected %+v", j, i, c, entry, wantEntry)
+				}
+				if values[j] != featureContributionValue(wantEntry) {
+					t.Fatalf("value %d of input %d and class %d is %v, expected %v", j, i, c, values[j], featureContributionValue(wantEntry))
+				}
+			}
+		}
+	}
+}
+
+func featureContributionValue(entry FeatureContributionEntry) float32 {
+	switch entry := entry.(type) {
+	case IdentityFeatureContribution:
+		return entry.FeatureContributionValue
+	case NormalizedFeatureContribution:
+		return entry.FeatureContributionValue
+	case OneHotEncodedFeatureContribution:
+		return entry.FeatureContributionValue
+	case BagOfWordsFeatureContribution:
+		return entry.FeatureContributionValue
+	case BagOfWordsCosineSimilarityFeatureContribution:
+		return entry.FeatureContributionValue
+	case WordEmbeddingFeatureContribution:
+		return entry.FeatureContributionValue
+	}
+	return 0
+}
+
+// Run with `go test -race` to check that a model can be shared by goroutines that predict and log at the same time.
+func TestConcurrentUse(t *testing.T) {
+	app := httptest.NewServer(http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {}))
+	defer app.Close()
+	model := loadTestModel(t, &LoadModelOptions{ModelFoxURL: app.URL, LogBatchSize: 10})
+	input := testInputs(200)
+	want := model.Predict(input, nil)
+	var wg sync.WaitGroup
+	for g := 0; g < 8; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			values := make([]float32, len(input))
+			classIndices := make([]int, len(input))
+			for iteration := 0; iteration < 20; iteration++ {
+				output := model.Predict(input, &PredictOptions{NumThreads: 2})
+				model.PredictInto(input, nil, values, classIndices)
+				for i := range input {
+					if outputClassName(output[i]) != outputClassName(want[i]) {
+						t.Errorf("prediction %d differs between goroutines", i)
+						return
+					}
+					if className := outputClassName(want[i]); className != "" && model.ClassName(classIndices[i]) != className {
+						t.Errorf("class index %d differs from the predict output", i)
+						return
+					}
+				}
+				model.EnqueueLogPrediction(LogPredictionArgs{
+					Identifier: strconv.Itoa(g*100 + iteration),
+					Input:      input[iteration],
+					Output:     output[iteration],
+				})
+			}
+		}(g)
+	}
+	wg.Wait()
+	if err := model.FlushLogQueue(); err != nil {
+		t.Fatal(err)
+	}
+	model.Destroy()
+}
+
+func outputClassName(output PredictOutput) string {
+	switch output := output.(type) {
+	case BinaryClassificationPredictOutput:
+		return output.ClassName
+	case MulticlassClassificationPredictOutput:
+		return output.ClassName
+	}
+	return ""
+}
+
+// Run with `go test -bench PredictNumThreads` to see how batch predictions scale with `PredictOptions.NumThreads`.
+func BenchmarkPredictNumThreads(b *testing.B) {
+	model := loadTestModel(b, nil)
+	defer model.Destroy()
+	input := testInputs(10000)
+	threadCounts := []int{1, 2, 4, 8}
+	if runtime.NumCPU() > 8 {
+		threadCounts = append(threadCounts, runtime.NumCPU())
+	}
+	for _, numThreads := range threadCounts {
+		b.Run("threads="+strconv.Itoa(numThreads), func(b *testing.B) {
+			options := PredictOptions{NumThreads: numThreads}
+			start := time.Now()
+			for i := 0; i < b.N; i++ {
+				model.Predict(input, &options)
+			}
+			b.ReportMetric(float64(b.N*len(input))/time.Since(start).Seconds(), "rows/s")
+		})
+	}
+}
+
+// Run with `go test -bench ModelMetadata` to check that reading the model's metadata and building log events do not call into libmodelfox. The cgo-calls/op metric counts the cgo calls made by each operation.
+func BenchmarkModelMetadata(b *testing.B) {
+	model := loadTestModel(b, nil)
+	defer model.Destroy()
+	input := testInputs(1)[0]
+	output := model.PredictOne(input, nil)
+	benchmarks := []struct {
+		name string
+		run  func()
+	}{
+		{"ID", func() { model.ID() }},
+		{"Classes", func() { model.Classes() }},
+		{"predictionEvent", func() {
+			model.predictionEvent(LogPredictionArgs{Identifier: "id", Input: input, Output: output})
+		}},
+		{"trueValueEvent", func() {
+			model.trueValueEvent(LogTrueValueArgs{Identifier: "id", TrueValue: "Positive"})
+		}},
+	}
+	for _, benchmark := range benchmarks {
+		b.Run(benchmark.name, func(b *testing.B) {
+			b.ReportAllocs()
+			cgoCalls := runtime.NumCgoCall()
+			for i := 0; i < b.N; i++ {
+				benchmark.run()
+			}
+			b.ReportMetric(float64(runtime.NumCgoCall()-cgoCalls)/float64(b.N), "cgo-calls/op")
+		})
+	}
+}